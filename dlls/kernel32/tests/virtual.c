@@ -55,6 +55,7 @@ static NTSTATUS (WINAPI *pNtReadVirtualMemory)(HANDLE,const void *,void *,SIZE_T
 static NTSTATUS (WINAPI *pNtWriteVirtualMemory)(HANDLE, void *, const void *, SIZE_T, SIZE_T *);
 static BOOL  (WINAPI *pPrefetchVirtualMemory)(HANDLE, ULONG_PTR, PWIN32_MEMORY_RANGE_ENTRY, ULONG);
 static void  (WINAPI *pFlushProcessWriteBuffers)(void);
+static SIZE_T (WINAPI *pGetLargePageMinimum)(void);
 
 /* ############################### */
 
@@ -559,6 +560,77 @@ static void test_VirtualAlloc(void)
     ok(VirtualFree(addr1, 0, MEM_RELEASE), "VirtualFree failed\n");
 }
 
+static void test_VirtualAlloc_large_pages(void)
+{
+    TOKEN_PRIVILEGES privs, old_privs;
+    MEMORY_BASIC_INFORMATION info;
+    HANDLE token = NULL;
+    DWORD len;
+    SIZE_T size;
+    void *addr;
+
+    if (!pGetLargePageMinimum)
+    {
+        win_skip("GetLargePageMinimum is not available.\n");
+        return;
+    }
+    size = pGetLargePageMinimum();
+    if (!size)
+    {
+        skip("Large pages are not supported.\n");
+        return;
+    }
+    ok(!(size & (size - 1)), "large page size %Ix is not a power of two\n", size);
+    ok(!(size % si.dwPageSize), "large page size %Ix is not a multiple of the page size\n", size);
+
+    SetLastError(0xdeadbeef);
+    addr = VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+    ok(!addr, "VirtualAlloc succeeded without SeLockMemoryPrivilege\n");
+    ok(GetLastError() == ERROR_PRIVILEGE_NOT_HELD, "got %lu\n", GetLastError());
+
+    privs.PrivilegeCount = 1;
+    privs.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+
+    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token) ||
+        !LookupPrivilegeValueA(NULL, SE_LOCK_MEMORY_NAME, &privs.Privileges[0].Luid) ||
+        !AdjustTokenPrivileges(token, FALSE, &privs, sizeof(old_privs), &old_privs, &len) ||
+        GetLastError() == ERROR_NOT_ALL_ASSIGNED)
+    {
+        skip("cannot enable SeLockMemoryPrivilege\n");
+        CloseHandle(token);
+        return;
+    }
+
+    SetLastError(0xdeadbeef);
+    addr = VirtualAlloc(NULL, size / 2, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+    ok(!addr, "VirtualAlloc succeeded with a partial large page\n");
+    ok(GetLastError() == ERROR_INVALID_PARAMETER, "got %lu\n", GetLastError());
+
+    SetLastError(0xdeadbeef);
+    addr = VirtualAlloc(NULL, size, MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE);
+    ok(!addr, "VirtualAlloc succeeded without MEM_COMMIT\n");
+    ok(GetLastError() == ERROR_INVALID_PARAMETER, "got %lu\n", GetLastError());
+
+    SetLastError(0xdeadbeef);
+    addr = VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+    /* this may still fail on Windows when there isn't enough contiguous physical memory */
+    ok(addr != NULL || broken(GetLastError() == ERROR_NO_SYSTEM_RESOURCES || GetLastError() == ERROR_NOT_ENOUGH_MEMORY),
+       "VirtualAlloc failed, error %lu\n", GetLastError());
+    if (addr)
+    {
+        ok(!((ULONG_PTR)addr & (size - 1)), "%p is not aligned to the large page size\n", addr);
+        ok(VirtualQuery(addr, &info, sizeof(info)) == sizeof(info), "VirtualQuery failed\n");
+        ok(info.RegionSize == size, "wrong size %Ix\n", info.RegionSize);
+        ok(info.State == MEM_COMMIT, "wrong state %lx\n", info.State);
+        ok(info.Protect == PAGE_READWRITE, "wrong protect %lx\n", info.Protect);
+        memset(addr, 0xcc, size);
+        ok(VirtualFree(addr, 0, MEM_RELEASE), "VirtualFree failed\n");
+    }
+
+    AdjustTokenPrivileges(token, FALSE, &old_privs, 0, NULL, NULL);
+    CloseHandle(token);
+}
+
 static void test_MapViewOfFile(void)
 {
     static const char testfile[] = "testfile.xxx";
@@ -4775,6 +4847,7 @@ START_TEST(virtual)
     pGetWriteWatch = (void *) GetProcAddress(hkernel32, "GetWriteWatch");
     pResetWriteWatch = (void *) GetProcAddress(hkernel32, "ResetWriteWatch");
     pGetProcessDEPPolicy = (void *)GetProcAddress( hkernel32, "GetProcessDEPPolicy" );
+    pGetLargePageMinimum = (void *)GetProcAddress( hkernel32, "GetLargePageMinimum" );
     pIsWow64Process = (void *)GetProcAddress( hkernel32, "IsWow64Process" );
     pNtAreMappedFilesTheSame = (void *)GetProcAddress( hntdll, "NtAreMappedFilesTheSame" );
     pNtCreateSection = (void *)GetProcAddress( hntdll, "NtCreateSection" );
@@ -4804,6 +4877,7 @@ START_TEST(virtual)
     test_VirtualProtect();
     test_VirtualAllocEx();
     test_VirtualAlloc();
+    test_VirtualAlloc_large_pages();
     test_MapViewOfFile();
     test_NtAreMappedFilesTheSame();
     test_CreateFileMapping();
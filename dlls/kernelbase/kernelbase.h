@@ -40,6 +40,7 @@ extern void init_console(void);
 
 extern const WCHAR windows_dir[];
 extern const WCHAR system_dir[];
+extern const struct _KUSER_SHARED_DATA *user_shared_data;
 
 static const BOOL is_win64 = (sizeof(void *) > sizeof(int));
 extern BOOL is_wow64;
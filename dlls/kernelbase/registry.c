@@ -1641,7 +1641,7 @@ LSTATUS WINAPI DECLSPEC_HOTPATCH RegQueryValueExW( HKEY hkey, LPCWSTR name, LPDW
     NTSTATUS status;
     UNICODE_STRING name_str;
     DWORD total_size;
-    char buffer[256], *buf_ptr = buffer;
+    char buffer[1024], *buf_ptr = buffer;
     KEY_VALUE_PARTIAL_INFORMATION *info = (KEY_VALUE_PARTIAL_INFORMATION *)buffer;
     static const int info_size = offsetof( KEY_VALUE_PARTIAL_INFORMATION, Data );
 
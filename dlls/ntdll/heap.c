@@ -44,6 +44,22 @@ WINE_DEFAULT_DEBUG_CHANNEL(heap);
 #define HEAP_LAL 1
 #define HEAP_LFH 2
 
+/* heap usage statistics, collected and reported by heap_dump when heap tracing is enabled */
+
+struct heap_statistics
+{
+    SIZE_T used_size;        /* size of the blocks in use, including LFH block groups */
+    SIZE_T peak_used_size;   /* maximum value reached by used_size */
+    SIZE_T used_blocks;      /* number of blocks in use, including LFH block groups */
+    SIZE_T large_size;       /* size of the large blocks, included in used_size */
+    SIZE_T large_blocks;     /* number of large blocks, included in used_blocks */
+    SIZE_T committed_size;   /* committed size of the heap regions */
+    SIZE_T reserved_size;    /* reserved size of the heap regions */
+    ULONG  group_count;      /* number of LFH block groups */
+    ULONG  commit_count;     /* number of times memory was committed */
+    ULONG  decommit_count;   /* number of times memory was decommitted */
+};
+
 
 /* undocumented RtlWalkHeap structure */
 
@@ -300,6 +316,15 @@ struct heap
     RTL_CRITICAL_SECTION cs;
     struct entry     free_lists[FREE_LIST_COUNT];
     struct bin      *bins;
+    SIZE_T           used_size;     /* Size of the blocks in use, including LFH groups */
+    SIZE_T           peak_used_size;/* Maximum value reached by used_size */
+    SIZE_T           used_blocks;   /* Number of blocks in use, including LFH groups */
+    SIZE_T           large_size;    /* Size of the large blocks in use */
+    SIZE_T           large_blocks;  /* Number of large blocks in use */
+    ULONG            group_count;   /* Number of LFH groups */
+    ULONG            commit_count;  /* Number of subheap commits */
+    ULONG            decommit_count;/* Number of subheap decommits */
+    BOOL             stats;         /* Whether the above statistics are collected */
     SUBHEAP          subheap;
 };
 
@@ -600,6 +625,22 @@ static void heap_set_status( const struct heap *heap, ULONG flags, NTSTATUS stat
     if (status) RtlSetLastWin32ErrorAndNtStatusFromNtStatus( status );
 }
 
+/* update the heap statistics, heap must be locked */
+static inline void heap_stats_alloc( struct heap *heap, SIZE_T block_size )
+{
+    if (!heap->stats) return;
+    heap->used_blocks++;
+    heap->used_size += block_size;
+    if (heap->used_size > heap->peak_used_size) heap->peak_used_size = heap->used_size;
+}
+
+static inline void heap_stats_free( struct heap *heap, SIZE_T block_size )
+{
+    if (!heap->stats) return;
+    heap->used_blocks--;
+    heap->used_size -= block_size;
+}
+
 static SIZE_T get_free_list_block_size( unsigned int index )
 {
     DWORD log = index >> FREE_LIST_LINEAR_BITS;
@@ -656,8 +697,37 @@ static inline struct entry *find_free_list( struct heap *heap, SIZE_T block_size
     return &heap->free_lists[index];
 }
 
+/* collect the heap usage statistics, heap must be locked */
+static void get_heap_statistics( const struct heap *heap, struct heap_statistics *stats )
+{
+    const ARENA_LARGE *arena;
+    const SUBHEAP *subheap;
+
+    stats->used_size      = heap->used_size;
+    stats->peak_used_size = heap->peak_used_size;
+    stats->used_blocks    = heap->used_blocks;
+    stats->large_size     = heap->large_size;
+    stats->large_blocks   = heap->large_blocks;
+    stats->group_count    = heap->group_count;
+    stats->commit_count   = heap->commit_count;
+    stats->decommit_count = heap->decommit_count;
+    stats->committed_size = stats->reserved_size = 0;
+    LIST_FOR_EACH_ENTRY( subheap, &heap->subheap_list, SUBHEAP, entry )
+    {
+        stats->committed_size += (char *)subheap_commit_end( subheap ) - (char *)subheap_base( subheap );
+        stats->reserved_size += subheap_size( subheap );
+    }
+    LIST_FOR_EACH_ENTRY( arena, &heap->large_list, ARENA_LARGE, entry )
+    {
+        SIZE_T size = (char *)&arena->block + arena->block_size - (char *)arena;
+        stats->committed_size += size;
+        stats->reserved_size += size;
+    }
+}
+
 static void heap_dump( const struct heap *heap )
 {
+    struct heap_statistics stats;
     const struct block *block;
     const ARENA_LARGE *large;
     const SUBHEAP *subheap;
@@ -666,14 +736,28 @@ static void heap_dump( const struct heap *heap )
     TRACE( "heap: %p\n", heap );
     TRACE( "  next %p\n", LIST_ENTRY( heap->entry.next, struct heap, entry ) );
 
+    if (heap->stats)
+    {
+        get_heap_statistics( heap, &stats );
+        TRACE( "  used %#Ix, peak %#Ix, blocks %Iu, large %#Ix (%Iu blocks), groups %lu\n",
+               stats.used_size, stats.peak_used_size, stats.used_blocks, stats.large_size, stats.large_blocks,
+               stats.group_count );
+        TRACE( "  committed %#Ix, reserved %#Ix, commits %lu, decommits %lu\n",
+               stats.committed_size, stats.reserved_size, stats.commit_count, stats.decommit_count );
+    }
+
     TRACE( "  bins:\n" );
     for (i = 0; heap->bins && i < BLOCK_SIZE_BIN_COUNT; i++)
     {
         const struct bin *bin = heap->bins + i;
         ULONG alloc = ReadNoFence( &bin->count_alloc ), freed = ReadNoFence( &bin->count_freed );
         if (!alloc && !freed) continue;
-        TRACE( "    %3u: size %#4Ix, alloc %ld, freed %ld, enabled %lu\n", i, BLOCK_BIN_SIZE( i ),
-               alloc, freed, ReadNoFence( &bin->enabled ) );
+        /* the counters are no longer updated once the bin is enabled */
+        if (ReadNoFence( &bin->enabled ))
+            TRACE( "    %3u: size %#4Ix, enabled, before enabling: alloc %ld, freed %ld\n", i,
+                   BLOCK_BIN_SIZE( i ), alloc, freed );
+        else
+            TRACE( "    %3u: size %#4Ix, alloc %ld, freed %ld\n", i, BLOCK_BIN_SIZE( i ), alloc, freed );
     }
 
     TRACE( "  free_lists: %p\n", heap->free_lists );
@@ -800,7 +884,7 @@ static SUBHEAP *find_subheap( const struct heap *heap, const struct block *block
 }
 
 
-static inline BOOL subheap_commit( const struct heap *heap, SUBHEAP *subheap, const struct block *block, SIZE_T block_size )
+static inline BOOL subheap_commit( struct heap *heap, SUBHEAP *subheap, const struct block *block, SIZE_T block_size )
 {
     const char *end = (char *)subheap_base( subheap ) + subheap_size( subheap ), *commit_end;
     SIZE_T size;
@@ -823,10 +907,11 @@ static inline BOOL subheap_commit( const struct heap *heap, SUBHEAP *subheap, co
     }
 
     subheap->data_size = (char *)commit_end - (char *)(subheap + 1);
+    if (heap->stats) heap->commit_count++;
     return TRUE;
 }
 
-static inline BOOL subheap_decommit( const struct heap *heap, SUBHEAP *subheap, const void *commit_end )
+static inline BOOL subheap_decommit( struct heap *heap, SUBHEAP *subheap, const void *commit_end )
 {
     char *base = subheap_base( subheap );
     SIZE_T size;
@@ -846,6 +931,7 @@ static inline BOOL subheap_decommit( const struct heap *heap, SUBHEAP *subheap,
     }
 
     subheap->data_size = (char *)commit_end - (char *)(subheap + 1);
+    if (heap->stats) heap->decommit_count++;
     return TRUE;
 }
 
@@ -913,6 +999,8 @@ static NTSTATUS heap_free_block( struct heap *heap, ULONG flags, struct block *b
     struct entry *entry;
     struct block *next;
 
+    heap_stats_free( heap, block_size );
+
     if ((next = next_block( subheap, block )) && (block_get_flags( next ) & BLOCK_FLAG_FREE))
     {
         /* merge with next block if it is free */
@@ -1022,6 +1110,12 @@ static NTSTATUS heap_allocate_large( struct heap *heap, ULONG flags, SIZE_T bloc
 
     heap_lock( heap, flags );
     list_add_tail( &heap->large_list, &arena->entry );
+    heap_stats_alloc( heap, arena->block_size );
+    if (heap->stats)
+    {
+        heap->large_size += arena->block_size;
+        heap->large_blocks++;
+    }
     heap_unlock( heap, flags );
 
     valgrind_make_noaccess( (char *)block + sizeof(*block) + arena->data_size,
@@ -1040,6 +1134,12 @@ static NTSTATUS heap_free_large( struct heap *heap, ULONG flags, struct block *b
 
     heap_lock( heap, flags );
     list_remove( &arena->entry );
+    heap_stats_free( heap, arena->block_size );
+    if (heap->stats)
+    {
+        heap->large_size -= arena->block_size;
+        heap->large_blocks--;
+    }
     heap_unlock( heap, flags );
 
     return NtFreeVirtualMemory( NtCurrentProcess(), &address, &size, MEM_RELEASE );
@@ -1528,6 +1628,10 @@ HANDLE WINAPI RtlCreateHeap( ULONG flags, void *addr, SIZE_T total_size, SIZE_T
     heap->magic         = HEAP_MAGIC;
     heap->grow_size     = HEAP_INITIAL_GROW_SIZE;
     heap->min_size      = commit_size;
+    heap->used_size     = heap->peak_used_size = heap->used_blocks = 0;
+    heap->large_size    = heap->large_blocks = 0;
+    heap->group_count   = heap->commit_count = heap->decommit_count = 0;
+    heap->stats         = TRACE_ON(heap);
     list_init( &heap->subheap_list );
     list_init( &heap->large_list );
 
@@ -1727,6 +1831,7 @@ static NTSTATUS heap_allocate_block( struct heap *heap, ULONG flags, SIZE_T bloc
     mark_block_tail( block, flags );
 
     if ((next = next_block( subheap, block ))) block_set_flags( next, BLOCK_FLAG_PREV_FREE, 0 );
+    heap_stats_alloc( heap, block_get_size( block ) );
 
     *ret = block + 1;
     return STATUS_SUCCESS;
@@ -1799,6 +1904,7 @@ static struct group *group_allocate( struct heap *heap, ULONG flags, SIZE_T bloc
         status = heap_allocate_large( heap, flags & ~HEAP_ZERO_MEMORY, group_block_size, group_size, (void **)&group );
     else
         status = heap_allocate_block( heap, flags & ~HEAP_ZERO_MEMORY, group_block_size, group_size, (void **)&group );
+    if (!status && heap->stats) heap->group_count++;
 
     heap_unlock( heap, flags );
 
@@ -1830,6 +1936,7 @@ static NTSTATUS group_release( struct heap *heap, ULONG flags, struct bin *bin,
     heap_lock( heap, flags );
 
     block_set_flags( block, BLOCK_FLAG_LFH, 0 );
+    if (heap->stats) heap->group_count--;
 
     if (block_get_flags( block ) & BLOCK_FLAG_LARGE)
         status = heap_free_large( heap, flags, block );
@@ -1858,11 +1965,13 @@ static inline ULONG heap_current_thread_affinity(void)
 /* acquire a group from the bin, thread takes ownership of a shared group or allocates a new one */
 static struct group *heap_acquire_bin_group( struct heap *heap, ULONG flags, SIZE_T block_size, struct bin *bin )
 {
-    ULONG affinity = NtCurrentTeb()->HeapVirtualAffinity;
+    struct group **affinity_group = bin_get_affinity_group( bin, NtCurrentTeb()->HeapVirtualAffinity );
     struct group *group;
     SLIST_ENTRY *entry;
 
-    if ((group = InterlockedExchangePointer( (void *)bin_get_affinity_group( bin, affinity ), NULL )))
+    /* avoid a locked exchange, and the cache line ownership it implies, when the slot is empty */
+    if (ReadPointerNoFence( (void **)affinity_group ) &&
+        (group = InterlockedExchangePointer( (void *)affinity_group, NULL )))
         return group;
 
     if ((entry = RtlInterlockedPopEntrySList( &bin->groups )))
@@ -2011,8 +2120,9 @@ static void heap_thread_detach_bin_groups( struct heap *heap )
     for (i = 0; i < BLOCK_SIZE_BIN_COUNT; ++i)
     {
         struct bin *bin = heap->bins + i;
-        struct group *group;
-        if (!(group = InterlockedExchangePointer( (void *)bin_get_affinity_group( bin, affinity ), NULL ))) continue;
+        struct group **affinity_group = bin_get_affinity_group( bin, affinity ), *group;
+        if (!ReadPointerNoFence( (void **)affinity_group )) continue;
+        if (!(group = InterlockedExchangePointer( (void *)affinity_group, NULL ))) continue;
         RtlInterlockedPushEntrySList( &bin->groups, &group->entry );
     }
 }
@@ -2058,8 +2168,12 @@ void *WINAPI DECLSPEC_HOTPATCH RtlAllocateHeap( HANDLE handle, ULONG flags, SIZE
         if (!status && heap->bins)
         {
             SIZE_T bin = BLOCK_SIZE_BIN( block_get_size( (struct block *)ptr - 1 ) );
-            InterlockedIncrement( &heap->bins[bin].count_alloc );
-            if (!ReadNoFence( &heap->bins[bin].enabled )) bin_try_enable( heap, &heap->bins[bin] );
+            /* the counters are only used for LFH activation, don't bounce their cache line afterwards */
+            if (!ReadNoFence( &heap->bins[bin].enabled ))
+            {
+                InterlockedIncrement( &heap->bins[bin].count_alloc );
+                bin_try_enable( heap, &heap->bins[bin] );
+            }
         }
     }
 
@@ -2103,7 +2217,8 @@ BOOLEAN WINAPI DECLSPEC_HOTPATCH RtlFreeHeap( HANDLE handle, ULONG flags, void *
         status = heap_free_block( heap, heap_flags, block );
         heap_unlock( heap, heap_flags );
 
-        if (!status && heap->bins) InterlockedIncrement( &heap->bins[bin].count_freed );
+        if (!status && heap->bins && !ReadNoFence( &heap->bins[bin].enabled ))
+            InterlockedIncrement( &heap->bins[bin].count_freed );
     }
 
     TRACE( "handle %p, flags %#lx, ptr %p, return %u, status %#lx.\n", handle, flags, ptr, !status, status );
@@ -2136,6 +2251,7 @@ static NTSTATUS heap_resize_block( struct heap *heap, ULONG flags, struct block
                                    SIZE_T size, SIZE_T old_block_size, SIZE_T *old_size, void **ret )
 {
     SUBHEAP *subheap = block_get_subheap( heap, block );
+    SIZE_T orig_block_size = old_block_size;
     struct block *next;
 
     if (block_size > old_block_size)
@@ -2168,6 +2284,8 @@ static NTSTATUS heap_resize_block( struct heap *heap, ULONG flags, struct block
     mark_block_tail( block, flags );
 
     if ((next = next_block( subheap, block ))) block_set_flags( next, BLOCK_FLAG_PREV_FREE, 0 );
+    heap_stats_free( heap, orig_block_size );
+    heap_stats_alloc( heap, block_get_size( block ) );
 
     *ret = block + 1;
     return STATUS_SUCCESS;
@@ -2214,9 +2332,13 @@ static NTSTATUS heap_resize_in_place( struct heap *heap, ULONG flags, struct blo
     if (!status && heap->bins)
     {
         SIZE_T new_bin = BLOCK_SIZE_BIN( block_size );
-        InterlockedIncrement( &heap->bins[old_bin].count_freed );
-        InterlockedIncrement( &heap->bins[new_bin].count_alloc );
-        if (!ReadNoFence( &heap->bins[new_bin].enabled )) bin_try_enable( heap, &heap->bins[new_bin] );
+        if (!ReadNoFence( &heap->bins[old_bin].enabled ))
+            InterlockedIncrement( &heap->bins[old_bin].count_freed );
+        if (!ReadNoFence( &heap->bins[new_bin].enabled ))
+        {
+            InterlockedIncrement( &heap->bins[new_bin].count_alloc );
+            bin_try_enable( heap, &heap->bins[new_bin] );
+        }
     }
 
     return status;
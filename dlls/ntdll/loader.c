@@ -140,6 +140,11 @@ typedef struct _wine_modref
     struct file_id        id;
     ULONG                 CheckSum;
     BOOL                  system;
+    DWORD                *export_hash;      /* hash table of export name indexes, built on demand */
+    DWORD                 export_hash_mask; /* number of hash table buckets minus one */
+    const IMAGE_EXPORT_DIRECTORY *export_hash_dir; /* export directory the hash table was built for */
+    DWORD                 export_hash_names; /* AddressOfNames of that directory */
+    DWORD                 export_hash_count; /* NumberOfNames of that directory */
 } WINE_MODREF;
 
 static UINT tls_module_count = 32;     /* number of modules with TLS directory */
@@ -195,7 +200,7 @@ static NTSTATUS process_attach( LDR_DDAG_NODE *node, LPVOID lpReserved );
 static FARPROC find_ordinal_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *exports,
                                     DWORD exp_size, DWORD ordinal, LPCWSTR load_path,
                                     WINE_MODREF *importer, BOOL is_dynamic );
-static FARPROC find_named_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *exports, DWORD exp_size,
+static FARPROC find_named_export( WINE_MODREF *wm, const IMAGE_EXPORT_DIRECTORY *exports, DWORD exp_size,
                                   const char *name, int hint, LPCWSTR load_path,
                                   WINE_MODREF *importer, BOOL is_dynamic );
 
@@ -995,7 +1000,7 @@ static FARPROC find_forwarded_export( HMODULE module, const char *forward, LPCWS
                                         atoi(name+1) - exports->Base, load_path,
                                         importer, is_dynamic );
         } else
-            proc = find_named_export( wm->ldr.DllBase, exports, exp_size, name, -1, load_path,
+            proc = find_named_export( wm, exports, exp_size, name, -1, load_path,
                                       importer, is_dynamic );
     }
 
@@ -1075,16 +1080,83 @@ static int find_name_in_exports( HMODULE module, const IMAGE_EXPORT_DIRECTORY *e
 }
 
 
+/* compute export name hash */
+static DWORD hash_export_name( const char *name )
+{
+    DWORD hash = 0;
+
+    while (*name) hash = hash * 31 + (unsigned char)*name++;
+    return hash;
+}
+
+
+/*************************************************************************
+ *		find_name_in_export_hash
+ *
+ * Helper for find_named_export. Large export tables are searched through a hash
+ * table of name indexes, built the first time the module is looked up by name,
+ * and rebuilt if the export directory it was built from has changed since.
+ * The loader_section must be locked while calling this function.
+ */
+static int find_name_in_export_hash( WINE_MODREF *wm, const IMAGE_EXPORT_DIRECTORY *exports, const char *name )
+{
+    HMODULE module = wm->ldr.DllBase;
+    const WORD *ordinals = get_rva( module, exports->AddressOfNameOrdinals );
+    const DWORD *names = get_rva( module, exports->AddressOfNames );
+    DWORD i, pos, size;
+
+    if (exports->NumberOfNames < 64 || exports->NumberOfNames > 0x100000)
+        return find_name_in_exports( module, exports, name );
+
+    if (wm->export_hash && (wm->export_hash_dir != exports ||
+                            wm->export_hash_names != exports->AddressOfNames ||
+                            wm->export_hash_count != exports->NumberOfNames))
+    {
+        RtlFreeHeap( GetProcessHeap(), 0, wm->export_hash );
+        wm->export_hash = NULL;
+    }
+
+    if (!wm->export_hash)
+    {
+        size = 128;
+        while (size < 2 * exports->NumberOfNames) size *= 2;
+        if (!(wm->export_hash = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY,
+                                                 size * sizeof(*wm->export_hash) )))
+            return find_name_in_exports( module, exports, name );
+        wm->export_hash_mask = size - 1;
+        wm->export_hash_dir = exports;
+        wm->export_hash_names = exports->AddressOfNames;
+        wm->export_hash_count = exports->NumberOfNames;
+
+        for (i = 0; i < exports->NumberOfNames; i++)
+        {
+            pos = hash_export_name( get_rva( module, names[i] ) ) & wm->export_hash_mask;
+            while (wm->export_hash[pos]) pos = (pos + 1) & wm->export_hash_mask;
+            wm->export_hash[pos] = i + 1;
+        }
+    }
+
+    pos = hash_export_name( name ) & wm->export_hash_mask;
+    while ((i = wm->export_hash[pos]))
+    {
+        if (!strcmp( get_rva( module, names[i - 1] ), name )) return ordinals[i - 1];
+        pos = (pos + 1) & wm->export_hash_mask;
+    }
+    return -1;
+}
+
+
 /*************************************************************************
  *		find_named_export
  *
  * Find an exported function by name.
  * The loader_section must be locked while calling this function.
  */
-static FARPROC find_named_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *exports, DWORD exp_size,
+static FARPROC find_named_export( WINE_MODREF *wm, const IMAGE_EXPORT_DIRECTORY *exports, DWORD exp_size,
                                   const char *name, int hint, LPCWSTR load_path, WINE_MODREF *importer,
                                   BOOL is_dynamic )
 {
+    HMODULE module = wm->ldr.DllBase;
     const WORD *ordinals = get_rva( module, exports->AddressOfNameOrdinals );
     const DWORD *names = get_rva( module, exports->AddressOfNames );
     int ordinal;
@@ -1097,8 +1169,8 @@ static FARPROC find_named_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *
             return find_ordinal_export( module, exports, exp_size, ordinals[hint], load_path, importer, is_dynamic );
     }
 
-    /* then do a binary search */
-    if ((ordinal = find_name_in_exports( module, exports, name )) == -1) return NULL;
+    /* then do a hashed lookup */
+    if ((ordinal = find_name_in_export_hash( wm, exports, name )) == -1) return NULL;
     return find_ordinal_export( module, exports, exp_size, ordinal, load_path, importer, is_dynamic );
 
 }
@@ -1240,7 +1312,7 @@ static BOOL import_dll( WINE_MODREF *wm, const IMAGE_IMPORT_DESCRIPTOR *descr, L
         {
             IMAGE_IMPORT_BY_NAME *pe_name;
             pe_name = get_rva( module, (DWORD)import_list->u1.AddressOfData );
-            thunk_list->u1.Function = (ULONG_PTR)find_named_export( imp_mod, exports, exp_size,
+            thunk_list->u1.Function = (ULONG_PTR)find_named_export( wmImp, exports, exp_size,
                                                                     (const char*)pe_name->Name,
                                                                     pe_name->Hint, load_path, wm, FALSE );
             if (!thunk_list->u1.Function)
@@ -2076,7 +2148,7 @@ NTSTATUS WINAPI LdrGetProcedureAddress(HMODULE module, const ANSI_STRING *name,
     else if ((exports = RtlImageDirectoryEntryToData( module, TRUE,
                                                       IMAGE_DIRECTORY_ENTRY_EXPORT, &exp_size )))
     {
-        void *proc = name ? find_named_export( module, exports, exp_size, name->Buffer, -1, NULL, wm, TRUE )
+        void *proc = name ? find_named_export( wm, exports, exp_size, name->Buffer, -1, NULL, wm, TRUE )
                           : find_ordinal_export( module, exports, exp_size, ord - exports->Base, NULL, wm, TRUE );
         if (proc)
         {
@@ -4006,6 +4078,7 @@ static void free_modref( WINE_MODREF *wm )
     NtUnmapViewOfSection( NtCurrentProcess(), wm->ldr.DllBase );
     if (cached_modref == wm) cached_modref = NULL;
     RtlFreeUnicodeString( &wm->ldr.FullDllName );
+    RtlFreeHeap( GetProcessHeap(), 0, wm->export_hash );
     RtlFreeHeap( GetProcessHeap(), 0, wm );
 }
 
@@ -3880,9 +3880,128 @@ static void test_NtAllocateReserveObject(void)
     }
 }
 
+#define SHM_REQUEST_LOOPS 20000
+
+/* time a batch of simple server calls */
+static void benchmark_server_calls( const char *desc )
+{
+    OBJECT_BASIC_INFORMATION info;
+    LARGE_INTEGER freq, start, end;
+    NTSTATUS status = STATUS_SUCCESS;
+    HANDLE event;
+    double secs;
+    ULONG len;
+    int i;
+
+    event = CreateEventA( NULL, FALSE, FALSE, NULL );
+    QueryPerformanceFrequency( &freq );
+    QueryPerformanceCounter( &start );
+    for (i = 0; i < SHM_REQUEST_LOOPS; i++)
+        if ((status = pNtQueryObject( event, ObjectBasicInformation, &info, sizeof(info), &len ))) break;
+    QueryPerformanceCounter( &end );
+    ok( !status, "NtQueryObject failed %#lx\n", status );
+    CloseHandle( event );
+
+    secs = (double)(end.QuadPart - start.QuadPart) / freq.QuadPart;
+    trace( "%s: %d calls in %.3f ms, %.0f calls/s\n", desc, i, secs * 1000, secs ? i / secs : 0.0 );
+}
+
+static DWORD WINAPI shm_requests_thread( void *arg )
+{
+    HANDLE event = arg;
+    char buffer[256];
+    UNICODE_STRING *str = (UNICODE_STRING *)buffer;
+    NTSTATUS status;
+    ULONG len;
+
+    ok( !WaitForSingleObject( event, 5000 ), "wait failed\n" );
+    status = pNtQueryObject( event, ObjectNameInformation, buffer, sizeof(buffer), &len );
+    ok( status == STATUS_SUCCESS, "NtQueryObject failed %lx\n", status );
+    ok( wcsstr( str->Buffer, L"\\om_shm_requests" ) != NULL, "wrong name %s\n", debugstr_w( str->Buffer ));
+    return 0;
+}
+
+/* run with WINE_SHM_REQUESTS=1, exercising requests that go through the shared
+ * memory buffers as well as those that have to fall back to the request pipe */
+static void test_shm_requests_child(void)
+{
+    static const DWORD big_size = 0x30000;
+    char small[16], *big, *buffer;
+    DWORD i, type, size;
+    HANDLE event, thread;
+    HKEY key;
+    LONG ret;
+
+    event = CreateEventA( NULL, FALSE, FALSE, "om_shm_requests" );
+    ok( event != NULL, "CreateEvent failed %lu\n", GetLastError() );
+    thread = CreateThread( NULL, 0, shm_requests_thread, event, 0, NULL );
+    ok( thread != NULL, "CreateThread failed %lu\n", GetLastError() );
+    SetEvent( event );
+    ok( !WaitForSingleObject( thread, 5000 ), "wait failed\n" );
+    CloseHandle( thread );
+    CloseHandle( event );
+
+    ret = RegCreateKeyExA( HKEY_CURRENT_USER, "Software\\Wine\\om_shm_requests", 0, NULL,
+                           REG_OPTION_VOLATILE, KEY_ALL_ACCESS, NULL, &key, NULL );
+    ok( !ret, "RegCreateKeyEx failed %ld\n", ret );
+
+    big = malloc( big_size );
+    buffer = malloc( big_size );
+    for (i = 0; i < big_size; i++) big[i] = i * 7;
+    ret = RegSetValueExA( key, "small", 0, REG_BINARY, (BYTE *)"0123456789", 10 );
+    ok( !ret, "RegSetValueEx failed %ld\n", ret );
+    ret = RegSetValueExA( key, "big", 0, REG_BINARY, (BYTE *)big, big_size );
+    ok( !ret, "RegSetValueEx failed %ld\n", ret );
+
+    size = sizeof(small);
+    ret = RegQueryValueExA( key, "small", NULL, &type, (BYTE *)small, &size );
+    ok( !ret, "RegQueryValueEx failed %ld\n", ret );
+    ok( size == 10 && !memcmp( small, "0123456789", 10 ), "wrong data\n" );
+
+    size = sizeof(small);
+    ret = RegQueryValueExA( key, "big", NULL, &type, (BYTE *)small, &size );
+    ok( ret == ERROR_MORE_DATA, "RegQueryValueEx returned %ld\n", ret );
+    ok( size == big_size, "got size %lu\n", size );
+
+    size = big_size;
+    ret = RegQueryValueExA( key, "big", NULL, &type, (BYTE *)buffer, &size );
+    ok( !ret, "RegQueryValueEx failed %ld\n", ret );
+    ok( size == big_size && !memcmp( buffer, big, big_size ), "wrong data\n" );
+
+    RegDeleteValueA( key, "big" );
+    RegDeleteValueA( key, "small" );
+    RegDeleteKeyA( key, "" );
+    RegCloseKey( key );
+    free( buffer );
+    free( big );
+
+    benchmark_server_calls( "WINE_SHM_REQUESTS=1" );
+}
+
+static void test_shm_requests( char **argv )
+{
+    STARTUPINFOA si = { sizeof(si) };
+    PROCESS_INFORMATION pi;
+    char cmdline[MAX_PATH];
+    BOOL ret;
+
+    benchmark_server_calls( "default" );
+
+    sprintf( cmdline, "\"%s\" om shm_requests", argv[0] );
+    SetEnvironmentVariableA( "WINE_SHM_REQUESTS", "1" );
+    ret = CreateProcessA( NULL, cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi );
+    SetEnvironmentVariableA( "WINE_SHM_REQUESTS", NULL );
+    ok( ret, "CreateProcess failed %lu\n", GetLastError() );
+    wait_child_process( &pi );
+    CloseHandle( pi.hProcess );
+    CloseHandle( pi.hThread );
+}
+
 START_TEST(om)
 {
     HMODULE hntdll = GetModuleHandleA("ntdll.dll");
+    char **argv;
+    int argc;
 
     pNtAllocateReserveObject= (void *)GetProcAddress(hntdll, "NtAllocateReserveObject");
     pNtCreateEvent          = (void *)GetProcAddress(hntdll, "NtCreateEvent");
@@ -3928,6 +4047,13 @@ START_TEST(om)
     pNtCompareObjects       =  (void *)GetProcAddress(hntdll, "NtCompareObjects");
     pNtOpenThread           =  (void *)GetProcAddress(hntdll, "NtOpenThread");
 
+    argc = winetest_get_mainargs( &argv );
+    if (argc >= 3 && !strcmp( argv[2], "shm_requests" ))
+    {
+        test_shm_requests_child();
+        return;
+    }
+
     test_null_in_object_name();
     test_case_sensitive();
     test_namespace_pipe();
@@ -3950,4 +4076,5 @@ START_TEST(om)
     test_object_permanence();
     test_zero_access();
     test_NtAllocateReserveObject();
+    test_shm_requests( argv );
 }
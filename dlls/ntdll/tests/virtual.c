@@ -738,6 +738,111 @@ static void test_NtAllocateVirtualMemoryEx(void)
        "Unexpected status %08lx.\n", status);
 }
 
+static void test_large_pages(void)
+{
+    const KUSER_SHARED_DATA *user_shared_data = (void *)0x7ffe0000;
+    SIZE_T size, large_page_size = user_shared_data->LargePageMinimum;
+    MEMORY_BASIC_INFORMATION mbi;
+    BOOLEAN enabled;
+    NTSTATUS status;
+    void *addr;
+
+    if (!large_page_size)
+    {
+        skip("Large pages are not supported.\n");
+        return;
+    }
+    ok(!(large_page_size & (large_page_size - 1)), "Unexpected large page size %#Ix.\n", large_page_size);
+    ok(!(large_page_size % page_size), "Unexpected large page size %#Ix.\n", large_page_size);
+
+    /* the test process doesn't hold SeLockMemoryPrivilege by default */
+    addr = NULL;
+    size = large_page_size;
+    status = NtAllocateVirtualMemory( NtCurrentProcess(), &addr, 0, &size,
+                                      MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE );
+    if (!status)
+    {
+        skip("SeLockMemoryPrivilege is enabled.\n");
+        size = 0;
+        NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
+        return;
+    }
+    ok(status == STATUS_PRIVILEGE_NOT_HELD, "Unexpected status %08lx.\n", status);
+    ok(!addr, "Got addr %p.\n", addr);
+
+    /* large pages must be reserved and committed at once */
+    addr = NULL;
+    size = large_page_size;
+    status = NtAllocateVirtualMemory( NtCurrentProcess(), &addr, 0, &size,
+                                      MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE );
+    ok(status == STATUS_INVALID_PARAMETER, "Unexpected status %08lx.\n", status);
+
+    /* the size must be a multiple of the large page size */
+    addr = NULL;
+    size = page_size;
+    status = NtAllocateVirtualMemory( NtCurrentProcess(), &addr, 0, &size,
+                                      MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE );
+    ok(status == STATUS_INVALID_PARAMETER || broken(status == STATUS_PRIVILEGE_NOT_HELD),
+       "Unexpected status %08lx.\n", status);
+
+    status = RtlAdjustPrivilege( SE_LOCK_MEMORY_PRIVILEGE, TRUE, FALSE, &enabled );
+    if (status) skip("Cannot enable SeLockMemoryPrivilege, status %08lx.\n", status);
+    else
+    {
+        addr = NULL;
+        size = large_page_size;
+        status = NtAllocateVirtualMemory( NtCurrentProcess(), &addr, 0, &size,
+                                          MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE );
+        /* this may fail on Windows when there isn't enough contiguous physical memory */
+        ok(!status || broken(status == STATUS_INSUFFICIENT_RESOURCES || status == STATUS_NO_MEMORY),
+           "Unexpected status %08lx.\n", status);
+        if (!status)
+        {
+            ok(!((ULONG_PTR)addr & (large_page_size - 1)), "Unaligned address %p.\n", addr);
+            ok(size == large_page_size, "Unexpected size %#Ix.\n", size);
+            status = NtQueryVirtualMemory( NtCurrentProcess(), addr, MemoryBasicInformation,
+                                           &mbi, sizeof(mbi), NULL );
+            ok(!status, "Unexpected status %08lx.\n", status);
+            ok(mbi.RegionSize == large_page_size, "Unexpected size %#Ix.\n", mbi.RegionSize);
+            ok(mbi.State == MEM_COMMIT, "Unexpected state %#lx.\n", mbi.State);
+            ok(mbi.Type == MEM_PRIVATE, "Unexpected type %#lx.\n", mbi.Type);
+            memset( addr, 0xcc, size );
+
+            size = 0;
+            status = NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
+            ok(!status, "Unexpected status %08lx.\n", status);
+        }
+        RtlAdjustPrivilege( SE_LOCK_MEMORY_PRIVILEGE, enabled, FALSE, &enabled );
+    }
+
+    if (!pNtAllocateVirtualMemoryEx)
+    {
+        win_skip("NtAllocateVirtualMemoryEx() is missing\n");
+        return;
+    }
+
+    /* placeholders can't be backed by large pages */
+    addr = NULL;
+    size = large_page_size;
+    status = pNtAllocateVirtualMemoryEx( NtCurrentProcess(), &addr, &size,
+                                         MEM_RESERVE | MEM_RESERVE_PLACEHOLDER | MEM_LARGE_PAGES,
+                                         PAGE_NOACCESS, NULL, 0 );
+    ok(status == STATUS_INVALID_PARAMETER, "Unexpected status %08lx.\n", status);
+
+    status = pNtAllocateVirtualMemoryEx( NtCurrentProcess(), &addr, &size,
+                                         MEM_RESERVE | MEM_RESERVE_PLACEHOLDER, PAGE_NOACCESS, NULL, 0 );
+    ok(!status, "Unexpected status %08lx.\n", status);
+
+    status = pNtAllocateVirtualMemoryEx( NtCurrentProcess(), &addr, &size,
+                                         MEM_RESERVE | MEM_COMMIT | MEM_REPLACE_PLACEHOLDER | MEM_LARGE_PAGES,
+                                         PAGE_READWRITE, NULL, 0 );
+    ok(status == STATUS_INVALID_PARAMETER, "Unexpected status %08lx.\n", status);
+
+    size = 0;
+    status = NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
+    ok(!status, "Unexpected status %08lx.\n", status);
+}
+
 static void test_NtAllocateVirtualMemoryEx_address_requirements(void)
 {
     MEM_EXTENDED_PARAMETER ext[2];
@@ -3514,6 +3619,7 @@ START_TEST(virtual)
     test_NtAllocateVirtualMemory();
     test_NtAllocateVirtualMemoryEx();
     test_NtAllocateVirtualMemoryEx_address_requirements();
+    test_large_pages();
     test_NtFreeVirtualMemory();
     test_NtProtectVirtualMemory();
     test_RtlCreateUserStack();
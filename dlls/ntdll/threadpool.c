@@ -29,6 +29,7 @@
 
 #include "wine/debug.h"
 #include "wine/list.h"
+#include "wine/rbtree.h"
 
 #include "ntdll_misc.h"
 
@@ -71,13 +72,14 @@ struct timer_queue;
 struct queue_timer
 {
     struct timer_queue *q;
-    struct list entry;
+    struct rb_entry entry;
     ULONG runcount;             /* number of callbacks pending execution */
     RTL_WAITORTIMERCALLBACKFUNC callback;
     PVOID param;
     DWORD period;
     ULONG flags;
     ULONGLONG expire;
+    ULONGLONG seq;              /* insertion order among timers with the same expiration */
     BOOL destroy;               /* timer should be deleted; once set, never unset */
     HANDLE event;               /* removal event */
 };
@@ -86,7 +88,8 @@ struct timer_queue
 {
     DWORD magic;
     RTL_CRITICAL_SECTION cs;
-    struct list timers;         /* sorted by expiration time */
+    struct rb_tree timers;      /* sorted by expiration time */
+    ULONGLONG seq;              /* sequence number of the last inserted timer */
     BOOL quit;                  /* queue should be deleted; once set, never unset */
     HANDLE event;
     HANDLE thread;
@@ -114,6 +117,7 @@ struct threadpool
     int                     min_workers;
     int                     num_workers;
     int                     num_busy_workers;
+    int                     num_idle_workers;
     HANDLE                  compl_port;
     TP_POOL_STACK_INFORMATION stack_info;
 };
@@ -178,9 +182,10 @@ struct threadpool_object
             /* information about the timer, locked via timerqueue.cs */
             BOOL            timer_initialized;
             BOOL            timer_pending;
-            struct list     timer_entry;
+            struct rb_entry timer_entry;
             BOOL            timer_set;
             ULONGLONG       timeout;
+            ULONGLONG       seq;
             LONG            period;
             LONG            window_length;
         } timer;
@@ -240,12 +245,26 @@ struct threadpool_group
 /* global timerqueue object */
 static RTL_CRITICAL_SECTION_DEBUG timerqueue_debug;
 
+static int compare_pending_timers( const void *key, const struct rb_entry *entry )
+{
+    const struct threadpool_object *timer = key;
+    const struct threadpool_object *other = RB_ENTRY_VALUE( entry, const struct threadpool_object, u.timer.timer_entry );
+
+    if (timer->u.timer.timeout != other->u.timer.timeout)
+        return timer->u.timer.timeout < other->u.timer.timeout ? -1 : 1;
+    /* timers expiring at the same time are kept in insertion order */
+    if (timer->u.timer.seq != other->u.timer.seq)
+        return timer->u.timer.seq < other->u.timer.seq ? -1 : 1;
+    return 0;
+}
+
 static struct
 {
     CRITICAL_SECTION        cs;
     LONG                    objcount;
     BOOL                    thread_running;
-    struct list             pending_timers;
+    struct rb_tree          pending_timers;
+    ULONGLONG               pending_seq;
     RTL_CONDITION_VARIABLE  update_event;
 }
 timerqueue =
@@ -253,7 +272,8 @@ timerqueue =
     { &timerqueue_debug, -1, 0, 0, 0, 0 },      /* cs */
     0,                                          /* objcount */
     FALSE,                                      /* thread_running */
-    LIST_INIT( timerqueue.pending_timers ),     /* pending_timers */
+    { compare_pending_timers, NULL },           /* pending_timers */
+    0,                                          /* pending_seq */
     RTL_CONDITION_VARIABLE_INIT                 /* update_event */
 };
 
@@ -568,12 +588,12 @@ static void queue_remove_timer(struct queue_timer *t)
     assert(t->runcount == 0);
     assert(t->destroy);
 
-    list_remove(&t->entry);
+    rb_remove(&q->timers, &t->entry);
     if (t->event)
         NtSetEvent(t->event, NULL);
     RtlFreeHeap(GetProcessHeap(), 0, t);
 
-    if (q->quit && list_empty(&q->timers))
+    if (q->quit && !q->timers.root)
         NtSetEvent(q->event, NULL);
 }
 
@@ -606,29 +626,40 @@ static inline ULONGLONG queue_current_time(void)
     return now.QuadPart * 1000 / freq.QuadPart;
 }
 
+static int queue_timer_compare(const void *key, const struct rb_entry *entry)
+{
+    const struct queue_timer *t = key;
+    const struct queue_timer *cur = RB_ENTRY_VALUE(entry, const struct queue_timer, entry);
+
+    if (t->expire != cur->expire)
+        return t->expire < cur->expire ? -1 : 1;
+    /* timers expiring at the same time are kept in insertion order */
+    if (t->seq != cur->seq)
+        return t->seq < cur->seq ? -1 : 1;
+    return 0;
+}
+
+static inline struct queue_timer *queue_first_timer(struct timer_queue *q)
+{
+    struct rb_entry *ptr = rb_head(q->timers.root);
+    return ptr ? RB_ENTRY_VALUE(ptr, struct queue_timer, entry) : NULL;
+}
+
 static void queue_add_timer(struct queue_timer *t, ULONGLONG time,
                             BOOL set_event)
 {
     /* We MUST hold the queue cs while calling this function.  */
     struct timer_queue *q = t->q;
-    struct list *ptr = &q->timers;
 
     assert(!q->quit || (t->destroy && time == EXPIRE_NEVER));
 
-    if (time != EXPIRE_NEVER)
-        LIST_FOR_EACH(ptr, &q->timers)
-        {
-            struct queue_timer *cur = LIST_ENTRY(ptr, struct queue_timer, entry);
-            if (time < cur->expire)
-                break;
-        }
-    list_add_before(ptr, &t->entry);
-
     t->expire = time;
+    t->seq = ++q->seq;
+    rb_put(&q->timers, t, &t->entry);
 
-    /* If we insert at the head of the list, we need to expire sooner
+    /* If we insert at the head of the queue, we need to expire sooner
        than expected.  */
-    if (set_event && &t->entry == list_head(&q->timers))
+    if (set_event && t == queue_first_timer(q))
         NtSetEvent(q->event, NULL);
 }
 
@@ -636,7 +667,7 @@ static inline void queue_move_timer(struct queue_timer *t, ULONGLONG time,
                                     BOOL set_event)
 {
     /* We MUST hold the queue cs while calling this function.  */
-    list_remove(&t->entry);
+    rb_remove(&t->q->timers, &t->entry);
     queue_add_timer(t, time, set_event);
 }
 
@@ -645,10 +676,9 @@ static void queue_timer_expire(struct timer_queue *q)
     struct queue_timer *t = NULL;
 
     RtlEnterCriticalSection(&q->cs);
-    if (list_head(&q->timers))
+    if ((t = queue_first_timer(q)))
     {
         ULONGLONG now, next;
-        t = LIST_ENTRY(list_head(&q->timers), struct queue_timer, entry);
         if (!t->destroy && t->expire <= ((now = queue_current_time())))
         {
             ++t->runcount;
@@ -691,9 +721,8 @@ static ULONG queue_get_timeout(struct timer_queue *q)
     ULONG timeout = INFINITE;
 
     RtlEnterCriticalSection(&q->cs);
-    if (list_head(&q->timers))
+    if ((t = queue_first_timer(q)))
     {
-        t = LIST_ENTRY(list_head(&q->timers), struct queue_timer, entry);
         assert(!t->destroy || t->expire == EXPIRE_NEVER);
 
         if (t->expire != EXPIRE_NEVER)
@@ -730,7 +759,7 @@ static void WINAPI timer_queue_thread_proc(LPVOID p)
                timer got put at the head of the list so we need to adjust
                our timeout.  */
             RtlEnterCriticalSection(&q->cs);
-            if (q->quit && list_empty(&q->timers))
+            if (q->quit && !q->timers.root)
                 done = TRUE;
             RtlLeaveCriticalSection(&q->cs);
         }
@@ -785,7 +814,8 @@ NTSTATUS WINAPI RtlCreateTimerQueue(PHANDLE NewTimerQueue)
         return STATUS_NO_MEMORY;
 
     RtlInitializeCriticalSection(&q->cs);
-    list_init(&q->timers);
+    rb_init(&q->timers, queue_timer_compare);
+    q->seq = 0;
     q->quit = FALSE;
     q->magic = TIMER_QUEUE_MAGIC;
     status = NtCreateEvent(&q->event, EVENT_ALL_ACCESS, NULL, SynchronizationEvent, FALSE);
@@ -826,7 +856,8 @@ NTSTATUS WINAPI RtlCreateTimerQueue(PHANDLE NewTimerQueue)
 NTSTATUS WINAPI RtlDeleteTimerQueueEx(HANDLE TimerQueue, HANDLE CompletionEvent)
 {
     struct timer_queue *q = TimerQueue;
-    struct queue_timer *t, *temp;
+    struct queue_timer *t;
+    struct rb_entry *ptr, *next;
     HANDLE thread;
     NTSTATUS status;
 
@@ -837,11 +868,19 @@ NTSTATUS WINAPI RtlDeleteTimerQueueEx(HANDLE TimerQueue, HANDLE CompletionEvent)
 
     RtlEnterCriticalSection(&q->cs);
     q->quit = TRUE;
-    if (list_head(&q->timers))
+    if (q->timers.root)
+    {
         /* When the last timer is removed, it will signal the timer thread to
-           exit...  */
-        LIST_FOR_EACH_ENTRY_SAFE(t, temp, &q->timers, struct queue_timer, entry)
-            queue_destroy_timer(t);
+           exit...  Timers with pending callbacks are moved to the end of the
+           queue, so skip the ones that are already destroyed.  */
+        for (ptr = rb_head(q->timers.root); ptr; ptr = next)
+        {
+            next = rb_next(ptr);
+            t = RB_ENTRY_VALUE(ptr, struct queue_timer, entry);
+            if (!t->destroy)
+                queue_destroy_timer(t);
+        }
+    }
     else
         /* However if we have none, we must do it ourselves.  */
         NtSetEvent(q->event, NULL);
@@ -1059,7 +1098,7 @@ static void CALLBACK timerqueue_thread_proc( void *param )
     ULONGLONG timeout_lower, timeout_upper, new_timeout;
     struct threadpool_object *other_timer;
     LARGE_INTEGER now, timeout;
-    struct list *ptr;
+    struct rb_entry *ptr;
 
     TRACE( "starting timer queue thread\n" );
     set_thread_name(L"wine_threadpool_timerqueue");
@@ -1070,16 +1109,16 @@ static void CALLBACK timerqueue_thread_proc( void *param )
         NtQuerySystemTime( &now );
 
         /* Check for expired timers. */
-        while ((ptr = list_head( &timerqueue.pending_timers )))
+        while ((ptr = rb_head( timerqueue.pending_timers.root )))
         {
-            struct threadpool_object *timer = LIST_ENTRY( ptr, struct threadpool_object, u.timer.timer_entry );
+            struct threadpool_object *timer = RB_ENTRY_VALUE( ptr, struct threadpool_object, u.timer.timer_entry );
             assert( timer->type == TP_OBJECT_TYPE_TIMER );
             assert( timer->u.timer.timer_pending );
             if (timer->u.timer.timeout > now.QuadPart)
                 break;
 
             /* Queue a new callback in one of the worker threads. */
-            list_remove( &timer->u.timer.timer_entry );
+            rb_remove( &timerqueue.pending_timers, &timer->u.timer.timer_entry );
             timer->u.timer.timer_pending = FALSE;
             tp_object_submit( timer, FALSE );
 
@@ -1090,14 +1129,8 @@ static void CALLBACK timerqueue_thread_proc( void *param )
                 if (timer->u.timer.timeout <= now.QuadPart)
                     timer->u.timer.timeout = now.QuadPart + 1;
 
-                LIST_FOR_EACH_ENTRY( other_timer, &timerqueue.pending_timers,
-                                     struct threadpool_object, u.timer.timer_entry )
-                {
-                    assert( other_timer->type == TP_OBJECT_TYPE_TIMER );
-                    if (timer->u.timer.timeout < other_timer->u.timer.timeout)
-                        break;
-                }
-                list_add_before( &other_timer->u.timer.timer_entry, &timer->u.timer.timer_entry );
+                timer->u.timer.seq = ++timerqueue.pending_seq;
+                rb_put( &timerqueue.pending_timers, timer, &timer->u.timer.timer_entry );
                 timer->u.timer.timer_pending = TRUE;
             }
         }
@@ -1105,9 +1138,9 @@ static void CALLBACK timerqueue_thread_proc( void *param )
         timeout_lower = timeout_upper = MAXLONGLONG;
 
         /* Determine next timeout and use the window length to optimize wakeup times. */
-        LIST_FOR_EACH_ENTRY( other_timer, &timerqueue.pending_timers,
-                             struct threadpool_object, u.timer.timer_entry )
+        for (ptr = rb_head( timerqueue.pending_timers.root ); ptr; ptr = rb_next( ptr ))
         {
+            other_timer = RB_ENTRY_VALUE( ptr, struct threadpool_object, u.timer.timer_entry );
             assert( other_timer->type == TP_OBJECT_TYPE_TIMER );
             if (other_timer->u.timer.timeout >= timeout_upper)
                 break;
@@ -1223,14 +1256,14 @@ static void tp_timerqueue_unlock( struct threadpool_object *timer )
         /* If timer was pending, remove it. */
         if (timer->u.timer.timer_pending)
         {
-            list_remove( &timer->u.timer.timer_entry );
+            rb_remove( &timerqueue.pending_timers, &timer->u.timer.timer_entry );
             timer->u.timer.timer_pending = FALSE;
         }
 
         /* If the last timer object was destroyed, then wake up the thread. */
         if (!--timerqueue.objcount)
         {
-            assert( list_empty( &timerqueue.pending_timers ) );
+            assert( !timerqueue.pending_timers.root );
             RtlWakeAllConditionVariable( &timerqueue.update_event );
         }
 
@@ -1700,6 +1733,7 @@ static NTSTATUS tp_threadpool_alloc( struct threadpool **out )
     pool->min_workers             = 0;
     pool->num_workers             = 0;
     pool->num_busy_workers        = 0;
+    pool->num_idle_workers        = 0;
     pool->stack_info.StackReserve = nt->OptionalHeader.SizeOfStackReserve;
     pool->stack_info.StackCommit  = nt->OptionalHeader.SizeOfStackCommit;
 
@@ -1998,6 +2032,7 @@ static void tp_object_submit( struct threadpool_object *object, BOOL signaled )
 {
     struct threadpool *pool = object->pool;
     NTSTATUS status = STATUS_UNSUCCESSFUL;
+    BOOL wake = FALSE;
 
     assert( !object->shutdown );
     assert( !pool->shutdown );
@@ -2018,14 +2053,20 @@ static void tp_object_submit( struct threadpool_object *object, BOOL signaled )
     if (object->type == TP_OBJECT_TYPE_WAIT && signaled)
         object->u.wait.signaled++;
 
-    /* No new thread started - wake up one existing thread. */
+    /* No new thread started - wake up one existing thread. Workers which are
+     * not waiting on the condition variable check the queue before going to
+     * sleep, so there is no need to signal unless one of them is idle. */
     if (status != STATUS_SUCCESS)
     {
         assert( pool->num_workers > 0 );
-        RtlWakeConditionVariable( &pool->update_event );
+        wake = pool->num_idle_workers > 0;
     }
 
     RtlLeaveCriticalSection( &pool->cs );
+
+    /* Wake the worker outside of the critical section, so that it doesn't
+     * immediately block on it. */
+    if (wake) RtlWakeConditionVariable( &pool->update_event );
 }
 
 /***********************************************************************
@@ -2360,6 +2401,7 @@ static void CALLBACK threadpool_worker_proc( void *param )
     struct threadpool *pool = param;
     LARGE_INTEGER timeout;
     struct list *ptr;
+    NTSTATUS status;
 
     TRACE( "starting worker thread for pool %p\n", pool );
     set_thread_name(L"wine_threadpool_worker");
@@ -2396,9 +2438,11 @@ static void CALLBACK threadpool_worker_proc( void *param )
          * min_workers == 0, then objcount is used to detect if the last thread
          * can be terminated. */
         timeout.QuadPart = (ULONGLONG)THREADPOOL_WORKER_TIMEOUT * -10000;
-        if (RtlSleepConditionVariableCS( &pool->update_event, &pool->cs, &timeout ) == STATUS_TIMEOUT &&
-            !threadpool_get_next_item( pool ) && (pool->num_workers > max( pool->min_workers, 1 ) ||
-            (!pool->min_workers && !pool->objcount)))
+        pool->num_idle_workers++;
+        status = RtlSleepConditionVariableCS( &pool->update_event, &pool->cs, &timeout );
+        pool->num_idle_workers--;
+        if (status == STATUS_TIMEOUT && !threadpool_get_next_item( pool ) &&
+            (pool->num_workers > max( pool->min_workers, 1 ) || (!pool->min_workers && !pool->objcount)))
         {
             break;
         }
@@ -2996,7 +3040,6 @@ BOOL WINAPI TpSetPoolMinThreads( TP_POOL *pool, DWORD minimum )
 VOID WINAPI TpSetTimer( TP_TIMER *timer, LARGE_INTEGER *timeout, LONG period, LONG window_length )
 {
     struct threadpool_object *this = impl_from_TP_TIMER( timer );
-    struct threadpool_object *other_timer;
     BOOL submit_timer = FALSE;
     ULONGLONG timestamp;
 
@@ -3035,7 +3078,7 @@ VOID WINAPI TpSetTimer( TP_TIMER *timer, LARGE_INTEGER *timeout, LONG period, LO
     /* First remove existing timeout. */
     if (this->u.timer.timer_pending)
     {
-        list_remove( &this->u.timer.timer_entry );
+        rb_remove( &timerqueue.pending_timers, &this->u.timer.timer_entry );
         this->u.timer.timer_pending = FALSE;
     }
 
@@ -3046,17 +3089,11 @@ VOID WINAPI TpSetTimer( TP_TIMER *timer, LARGE_INTEGER *timeout, LONG period, LO
         this->u.timer.period        = period;
         this->u.timer.window_length = window_length;
 
-        LIST_FOR_EACH_ENTRY( other_timer, &timerqueue.pending_timers,
-                             struct threadpool_object, u.timer.timer_entry )
-        {
-            assert( other_timer->type == TP_OBJECT_TYPE_TIMER );
-            if (this->u.timer.timeout < other_timer->u.timer.timeout)
-                break;
-        }
-        list_add_before( &other_timer->u.timer.timer_entry, &this->u.timer.timer_entry );
+        this->u.timer.seq = ++timerqueue.pending_seq;
+        rb_put( &timerqueue.pending_timers, this, &this->u.timer.timer_entry );
 
         /* Wake up the timer thread when the timeout has to be updated. */
-        if (list_head( &timerqueue.pending_timers ) == &this->u.timer.timer_entry )
+        if (rb_head( timerqueue.pending_timers.root ) == &this->u.timer.timer_entry)
             RtlWakeAllConditionVariable( &timerqueue.update_event );
 
         this->u.timer.timer_pending = TRUE;
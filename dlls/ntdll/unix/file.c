@@ -51,6 +51,7 @@
 #endif
 #include <sys/socket.h>
 #include <sys/time.h>
+#include <sys/uio.h>
 #include <sys/ioctl.h>
 #ifdef HAVE_SYS_ATTR_H
 #include <sys/attr.h>
@@ -2885,6 +2886,279 @@ NTSTATUS WINAPI NtQueryDirectoryFile( HANDLE handle, HANDLE event, PIO_APC_ROUTI
 }
 
 
+/* cache of directory contents used for case-insensitive lookups */
+#define MAX_DIR_LOOKUP_NAMES 8192  /* larger directories are not cached */
+
+struct dir_lookup_name
+{
+    struct dir_lookup_name *next;       /* next name in the same long name hash bucket */
+    struct dir_lookup_name *short_next; /* next name in the same short name hash bucket */
+    unsigned int   hash;                /* hash of the uppercase Unicode name */
+    unsigned int   len;                 /* length of the Unicode name */
+    unsigned int   short_len;           /* length of the generated 8.3 name, 0 if the name is 8.3 */
+    WCHAR          short_name[12];      /* generated 8.3 name */
+    char          *unix_name;           /* Unix file name in host encoding */
+    WCHAR          name[1];             /* Unicode file name */
+};
+
+struct dir_lookup_cache
+{
+    struct file_identity     id;            /* directory file identity */
+    struct timespec          mtime;         /* directory modification time when it was scanned */
+    struct timespec          ctime;         /* directory status change time when it was scanned */
+    unsigned int             mask;          /* number of hash buckets minus one */
+    struct dir_lookup_name **names;         /* names hashed by their long name */
+    struct dir_lookup_name **short_names;   /* names hashed by their generated 8.3 name */
+};
+
+static struct dir_lookup_cache dir_lookup_cache[16];
+static unsigned int dir_lookup_next;
+static pthread_mutex_t dir_lookup_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static unsigned int hash_dir_lookup_name( const WCHAR *name, unsigned int len )
+{
+    unsigned int i, hash = 0;
+
+    for (i = 0; i < len; i++) hash = hash * 31 + towupper( name[i] );
+    return hash;
+}
+
+static void free_dir_lookup_list( struct dir_lookup_name *entry )
+{
+    struct dir_lookup_name *next;
+
+    for ( ; entry; entry = next)
+    {
+        next = entry->next;
+        free( entry );
+    }
+}
+
+static void free_dir_lookup_cache( struct dir_lookup_cache *cache )
+{
+    unsigned int i;
+
+    if (cache->names)
+        for (i = 0; i <= cache->mask; i++) free_dir_lookup_list( cache->names[i] );
+    free( cache->names );
+    memset( cache, 0, sizeof(*cache) );
+}
+
+static struct dir_lookup_name *alloc_dir_lookup_name( const char *unix_name )
+{
+    WCHAR buffer[MAX_DIR_ENTRY_LEN];
+    struct dir_lookup_name *entry;
+    size_t unix_len = strlen( unix_name ) + 1;
+    int len;
+
+    len = ntdll_umbstowcs( unix_name, unix_len - 1, buffer, MAX_DIR_ENTRY_LEN );
+    if (!(entry = malloc( offsetof( struct dir_lookup_name, name[len] ) + unix_len ))) return NULL;
+    entry->next = entry->short_next = NULL;
+    entry->hash = hash_dir_lookup_name( buffer, len );
+    entry->len = len;
+    entry->short_len = 0;
+    if (!is_legal_8dot3_name( buffer, len ))
+        entry->short_len = hash_short_file_name( buffer, len, entry->short_name );
+    entry->unix_name = (char *)&entry->name[len];
+    memcpy( entry->name, buffer, len * sizeof(WCHAR) );
+    memcpy( entry->unix_name, unix_name, unix_len );
+    return entry;
+}
+
+/* build the hash tables from a list of names in reverse directory order */
+static BOOL hash_dir_lookup_names( struct dir_lookup_cache *cache, struct dir_lookup_name *list,
+                                   unsigned int count )
+{
+    struct dir_lookup_name *entry, *next;
+    unsigned int size = 16, pos;
+
+    while (size < count) size *= 2;
+    if (!(cache->names = calloc( 2 * size, sizeof(*cache->names) )))
+    {
+        free_dir_lookup_list( list );
+        return FALSE;
+    }
+    cache->short_names = cache->names + size;
+    cache->mask = size - 1;
+
+    /* inserting at the head of the buckets restores the directory order */
+    for (entry = list; entry; entry = next)
+    {
+        next = entry->next;
+        pos = entry->hash & cache->mask;
+        entry->next = cache->names[pos];
+        cache->names[pos] = entry;
+        if (!entry->short_len) continue;
+        pos = hash_dir_lookup_name( entry->short_name, entry->short_len ) & cache->mask;
+        entry->short_next = cache->short_names[pos];
+        cache->short_names[pos] = entry;
+    }
+    return TRUE;
+}
+
+/***********************************************************************
+ *           get_dir_lookup_times
+ *
+ * Get the directory times used to detect changes, with nanosecond precision when available.
+ */
+static void get_dir_lookup_times( const struct stat *st, struct timespec *mtime, struct timespec *ctime )
+{
+    mtime->tv_sec = st->st_mtime;
+    ctime->tv_sec = st->st_ctime;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    mtime->tv_nsec = st->st_mtim.tv_nsec;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+    mtime->tv_nsec = st->st_mtimespec.tv_nsec;
+#else
+    mtime->tv_nsec = 0;
+#endif
+#ifdef HAVE_STRUCT_STAT_ST_CTIM
+    ctime->tv_nsec = st->st_ctim.tv_nsec;
+#elif defined(HAVE_STRUCT_STAT_ST_CTIMESPEC)
+    ctime->tv_nsec = st->st_ctimespec.tv_nsec;
+#else
+    ctime->tv_nsec = 0;
+#endif
+}
+
+/* check that the directory times are still the ones recorded when it was scanned */
+static BOOL dir_lookup_times_match( const struct stat *st, const struct timespec *mtime,
+                                    const struct timespec *ctime )
+{
+    struct timespec cur_mtime, cur_ctime;
+
+    get_dir_lookup_times( st, &cur_mtime, &cur_ctime );
+    return cur_mtime.tv_sec == mtime->tv_sec && cur_mtime.tv_nsec == mtime->tv_nsec &&
+           cur_ctime.tv_sec == ctime->tv_sec && cur_ctime.tv_nsec == ctime->tv_nsec;
+}
+
+/***********************************************************************
+ *           load_dir_lookup_cache
+ *
+ * Read the contents of a directory into a free cache slot.
+ * Must be called with dir_lookup_mutex held.
+ */
+static struct dir_lookup_cache *load_dir_lookup_cache( int root_fd, const char *unix_name, const struct stat *st )
+{
+    struct dir_lookup_cache *cache = &dir_lookup_cache[dir_lookup_next];
+    struct dir_lookup_name *list = NULL, *entry;
+    unsigned int count = 0;
+    struct timespec mtime, ctime;
+    struct dirent *de;
+    struct stat st2;
+    DIR *dir;
+    int fd;
+
+    if ((fd = openat( root_fd, unix_name, O_RDONLY | O_DIRECTORY )) == -1) return NULL;
+    if (!(dir = fdopendir( fd )))
+    {
+        close( fd );
+        return NULL;
+    }
+
+    while ((de = readdir( dir )))
+    {
+        if (count == MAX_DIR_LOOKUP_NAMES || !(entry = alloc_dir_lookup_name( de->d_name ))) break;
+        entry->next = list;
+        list = entry;
+        count++;
+    }
+
+    /* discard the result if the directory changed while we were reading it */
+    get_dir_lookup_times( st, &mtime, &ctime );
+    if (de || fstat( dirfd( dir ), &st2 ) == -1 ||
+        st2.st_dev != st->st_dev || st2.st_ino != st->st_ino || !dir_lookup_times_match( &st2, &mtime, &ctime ))
+    {
+        closedir( dir );
+        free_dir_lookup_list( list );
+        return NULL;
+    }
+    closedir( dir );
+
+    free_dir_lookup_cache( cache );
+    if (!hash_dir_lookup_names( cache, list, count )) return NULL;
+    cache->id.dev = st->st_dev;
+    cache->id.ino = st->st_ino;
+    cache->mtime = mtime;
+    cache->ctime = ctime;
+    dir_lookup_next = (dir_lookup_next + 1) % ARRAY_SIZE(dir_lookup_cache);
+    return cache;
+}
+
+/***********************************************************************
+ *           get_dir_lookup_cache
+ *
+ * Find the cached contents of a directory, loading them if needed.
+ * Must be called with dir_lookup_mutex held.
+ */
+static struct dir_lookup_cache *get_dir_lookup_cache( int root_fd, const char *unix_name, const struct stat *st )
+{
+    unsigned int i;
+
+    for (i = 0; i < ARRAY_SIZE(dir_lookup_cache); i++)
+    {
+        struct dir_lookup_cache *cache = &dir_lookup_cache[i];
+
+        if (!cache->names || cache->id.dev != st->st_dev || cache->id.ino != st->st_ino) continue;
+        if (dir_lookup_times_match( st, &cache->mtime, &cache->ctime )) return cache;
+        free_dir_lookup_cache( cache );
+        break;
+    }
+
+    /* only cache directories that have not been modified recently, so that a change
+     * made in the same timestamp tick as our scan is still detected by the time checks */
+    if (max( st->st_mtime, st->st_ctime ) >= time( NULL ) - 1) return NULL;
+    return load_dir_lookup_cache( root_fd, unix_name, st );
+}
+
+/***********************************************************************
+ *           find_file_in_dir_cache
+ *
+ * Case-insensitive search for a file using the directory lookup cache.
+ * Returns STATUS_NOT_SUPPORTED if the directory contents could not be cached.
+ */
+static NTSTATUS find_file_in_dir_cache( int root_fd, char *unix_name, int pos, const WCHAR *name, int length,
+                                        BOOLEAN is_name_8_dot_3 )
+{
+    struct dir_lookup_cache *cache;
+    struct dir_lookup_name *entry;
+    unsigned int hash;
+    NTSTATUS status;
+    struct stat st;
+
+    if (fstatat( root_fd, unix_name, &st, 0 ) == -1 || !S_ISDIR( st.st_mode )) return STATUS_NOT_SUPPORTED;
+
+    hash = hash_dir_lookup_name( name, length );
+
+    mutex_lock( &dir_lookup_mutex );
+    if (!(cache = get_dir_lookup_cache( root_fd, unix_name, &st )))
+    {
+        mutex_unlock( &dir_lookup_mutex );
+        return STATUS_NOT_SUPPORTED;
+    }
+
+    for (entry = cache->names[hash & cache->mask]; entry; entry = entry->next)
+        if (entry->hash == hash && entry->len == length && !wcsnicmp( entry->name, name, length )) break;
+
+    if (!entry && is_name_8_dot_3)
+    {
+        for (entry = cache->short_names[hash & cache->mask]; entry; entry = entry->short_next)
+            if (entry->short_len == length && !wcsnicmp( entry->short_name, name, length )) break;
+    }
+
+    if (entry)
+    {
+        unix_name[pos - 1] = '/';
+        strcpy( unix_name + pos, entry->unix_name );
+        status = STATUS_SUCCESS;
+    }
+    else status = STATUS_OBJECT_NAME_NOT_FOUND;
+
+    mutex_unlock( &dir_lookup_mutex );
+    return status;
+}
+
+
 /***********************************************************************
  *           find_file_in_dir
  *
@@ -2897,6 +3171,7 @@ static NTSTATUS find_file_in_dir( int root_fd, char *unix_name, int pos, const W
 {
     WCHAR buffer[MAX_DIR_ENTRY_LEN];
     BOOLEAN is_name_8_dot_3;
+    NTSTATUS status;
     DIR *dir;
     struct dirent *de;
     struct stat st;
@@ -2975,6 +3250,10 @@ static NTSTATUS find_file_in_dir( int root_fd, char *unix_name, int pos, const W
     }
 #endif /* VFAT_IOCTL_READDIR_BOTH */
 
+    status = find_file_in_dir_cache( root_fd, unix_name, pos, name, length, is_name_8_dot_3 );
+    if (status == STATUS_SUCCESS) return status;
+    if (status == STATUS_OBJECT_NAME_NOT_FOUND) goto not_found;
+
     if ((fd = openat( root_fd, unix_name, O_RDONLY )) == -1) return errno_to_status( errno );
     if (!(dir = fdopendir( fd )))
     {
@@ -5825,6 +6104,26 @@ err:
 }
 
 
+/* build an iovec array for the page-sized segments of a scatter/gather request */
+static unsigned int get_segments_iovec( struct iovec *iov, unsigned int max, const FILE_SEGMENT_ELEMENT *segments,
+                                        UINT pos, UINT length )
+{
+    unsigned int count = 0;
+
+    while (length && count < max)
+    {
+        UINT len = min( length, page_size - pos );
+
+        iov[count].iov_base = (char *)(ULONG_PTR)segments[count].Buffer + pos;
+        iov[count].iov_len = len;
+        length -= len;
+        pos = 0;
+        count++;
+    }
+    return count;
+}
+
+
 /******************************************************************************
  *              NtReadFileScatter   (NTDLL.@)
  */
@@ -5833,8 +6132,9 @@ NTSTATUS WINAPI NtReadFileScatter( HANDLE file, HANDLE event, PIO_APC_ROUTINE ap
                                    ULONG length, LARGE_INTEGER *offset, ULONG *key )
 {
     int result, unix_handle, needs_close;
-    unsigned int options, status;
+    unsigned int options, status, count;
     UINT pos = 0, total = 0;
+    struct iovec iov[64];
     client_ptr_t iosb_ptr = iosb_client_ptr(io);
     enum server_fd_type type;
     ULONG_PTR cvalue = apc ? 0 : (ULONG_PTR)apc_user;
@@ -5858,11 +6158,16 @@ NTSTATUS WINAPI NtReadFileScatter( HANDLE file, HANDLE event, PIO_APC_ROUTINE ap
 
     while (length)
     {
+        count = get_segments_iovec( iov, ARRAY_SIZE(iov), segments, pos, length );
+
         if (offset && offset->QuadPart != FILE_USE_FILE_POINTER_POSITION)
-            result = pread( unix_handle, (char *)segments->Buffer + pos,
-                            min( length - pos, page_size - pos ), offset->QuadPart + total );
+#ifdef HAVE_PREADV
+            result = preadv( unix_handle, iov, count, offset->QuadPart + total );
+#else
+            result = pread( unix_handle, iov[0].iov_base, iov[0].iov_len, offset->QuadPart + total );
+#endif
         else
-            result = read( unix_handle, (char *)segments->Buffer + pos, min( length - pos, page_size - pos ) );
+            result = readv( unix_handle, iov, count );
 
         if (result == -1)
         {
@@ -5873,11 +6178,9 @@ NTSTATUS WINAPI NtReadFileScatter( HANDLE file, HANDLE event, PIO_APC_ROUTINE ap
         if (!result) break;
         total += result;
         length -= result;
-        if ((pos += result) == page_size)
-        {
-            pos = 0;
-            segments++;
-        }
+        pos += result;
+        segments += pos / page_size;
+        pos %= page_size;
     }
 
     if (total == 0) status = STATUS_END_OF_FILE;
@@ -6135,8 +6438,9 @@ NTSTATUS WINAPI NtWriteFileGather( HANDLE file, HANDLE event, PIO_APC_ROUTINE ap
                                    ULONG length, LARGE_INTEGER *offset, ULONG *key )
 {
     int result, unix_handle, needs_close;
-    unsigned int options, status;
+    unsigned int options, status, count;
     UINT pos = 0, total = 0;
+    struct iovec iov[64];
     enum server_fd_type type;
 
     TRACE( "(%p,%p,%p,%p,%p,%p,0x%08x,%p,%p),partial stub!\n",
@@ -6158,11 +6462,16 @@ NTSTATUS WINAPI NtWriteFileGather( HANDLE file, HANDLE event, PIO_APC_ROUTINE ap
 
     while (length)
     {
+        count = get_segments_iovec( iov, ARRAY_SIZE(iov), segments, pos, length );
+
         if (offset && offset->QuadPart != FILE_USE_FILE_POINTER_POSITION)
-            result = pwrite( unix_handle, (char *)segments->Buffer + pos,
-                             page_size - pos, offset->QuadPart + total );
+#ifdef HAVE_PWRITEV
+            result = pwritev( unix_handle, iov, count, offset->QuadPart + total );
+#else
+            result = pwrite( unix_handle, iov[0].iov_base, iov[0].iov_len, offset->QuadPart + total );
+#endif
         else
-            result = write( unix_handle, (char *)segments->Buffer + pos, page_size - pos );
+            result = writev( unix_handle, iov, count );
 
         if (result == -1)
         {
@@ -6182,11 +6491,9 @@ NTSTATUS WINAPI NtWriteFileGather( HANDLE file, HANDLE event, PIO_APC_ROUTINE ap
         }
         total += result;
         length -= result;
-        if ((pos += result) == page_size)
-        {
-            pos = 0;
-            segments++;
-        }
+        pos += result;
+        segments += pos / page_size;
+        pos %= page_size;
     }
 
  done:
@@ -70,6 +70,10 @@
 #define _POSIX_SPAWN_DISABLE_ASLR 0x0100
 #endif
 #endif
+#ifdef __linux__
+#include <poll.h>
+#include <linux/futex.h>
+#endif
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
@@ -106,6 +110,15 @@ static int initial_cwd = -1;
 static pid_t server_pid;
 pthread_mutex_t fd_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+#ifdef __linux__
+/* number of spins waiting for a shared memory reply before sleeping */
+#define REQUEST_SHM_SPIN_COUNT 1000
+
+static BOOL use_request_shm;  /* pass requests through shared memory buffers */
+static request_shm_control_t *request_shm_control;  /* control page shared with the server */
+static int request_shm_doorbell = -1;  /* eventfd to wake up an idle server */
+#endif
+
 /* atomically exchange a 64-bit value */
 static inline LONG64 interlocked_xchg64( LONG64 *dest, LONG64 val )
 {
@@ -275,12 +288,120 @@ static void read_reply_data( void *buffer, size_t size )
  */
 static inline unsigned int wait_reply( struct __server_request_info *req )
 {
-    read_reply_data( &req->u.reply, sizeof(req->u.reply) );
+    struct iovec vec[2];
+    data_size_t size = 0;
+    int ret;
+
+    /* the server writes the reply and its data at once, so try to get both in a single syscall */
+    vec[0].iov_base = &req->u.reply;
+    vec[0].iov_len  = sizeof(req->u.reply);
+    vec[1].iov_base = req->reply_data;
+    vec[1].iov_len  = req->u.req.request_header.reply_size;
+
+    while ((ret = readv( ntdll_get_thread_data()->reply_fd, vec, 2 )) == -1 && errno == EINTR);
+
+    if (ret >= (int)sizeof(req->u.reply)) size = ret - sizeof(req->u.reply);
+    else if (ret > 0) read_reply_data( (char *)&req->u.reply + ret, sizeof(req->u.reply) - ret );
+    else if (!ret || errno == EPIPE) abort_thread(0);  /* the server closed the connection */
+    else server_protocol_perror( "read" );
+
+    if (req->u.reply.reply_header.reply_size > size)
+        read_reply_data( (char *)req->reply_data + size, req->u.reply.reply_header.reply_size - size );
+    return req->u.reply.reply_header.error;
+}
+
+
+#ifdef __linux__
+
+/***********************************************************************
+ *           can_use_request_shm
+ *
+ * Check if a request and its reply fit in the shared memory buffer.
+ */
+static BOOL can_use_request_shm( const struct __server_request_info *req )
+{
+    const data_size_t max_size = REQUEST_SHM_SIZE - sizeof(request_shm_t) - sizeof(req->u);
+    unsigned int i;
+
+    if (req->u.req.request_header.request_size > max_size) return FALSE;
+    if (req->u.req.request_header.reply_size > max_size) return FALSE;
+    /* let the pipe write report invalid buffers */
+    for (i = 0; i < req->data_count; i++)
+        if (!virtual_check_buffer_for_read( req->data[i].ptr, req->data[i].size )) return FALSE;
+    return TRUE;
+}
+
+
+/***********************************************************************
+ *           wait_shm_reply
+ *
+ * Wait for the server to process the request queued in the shared memory buffer.
+ */
+static int wait_shm_reply( request_shm_t *shm )
+{
+    struct timespec timeout = { 1, 0 };
+    struct pollfd pfd;
+    int i, state;
+
+    for (i = 0; i < REQUEST_SHM_SPIN_COUNT; i++)
+    {
+        if ((state = __atomic_load_n( &shm->state, __ATOMIC_ACQUIRE )) != REQUEST_SHM_REQUEST) return state;
+        YieldProcessor();
+    }
+
+    __atomic_store_n( &shm->waiting, 1, __ATOMIC_SEQ_CST );
+    while ((state = __atomic_load_n( &shm->state, __ATOMIC_SEQ_CST )) == REQUEST_SHM_REQUEST)
+    {
+        if (!syscall( __NR_futex, &shm->state, FUTEX_WAIT, REQUEST_SHM_REQUEST, &timeout, 0, 0 )) continue;
+        if (errno != ETIMEDOUT) continue;
+
+        /* make sure the server didn't go away */
+        pfd.fd = ntdll_get_thread_data()->reply_fd;
+        pfd.events = POLLIN;
+        if (poll( &pfd, 1, 0 ) == 1 && (pfd.revents & (POLLHUP | POLLERR))) abort_thread(0);
+    }
+    __atomic_store_n( &shm->waiting, 0, __ATOMIC_RELAXED );
+    return state;
+}
+
+
+/***********************************************************************
+ *           server_call_shm
+ *
+ * Perform a server call through the shared memory buffer of the thread.
+ */
+static unsigned int server_call_shm( request_shm_t *shm, struct __server_request_info *req )
+{
+    static const UINT64 doorbell = 1;
+    char *ptr = (char *)(shm + 1);
+    unsigned int i;
+
+    memcpy( ptr, &req->u.req, sizeof(req->u.req) );
+    ptr += sizeof(req->u.req);
+    for (i = 0; i < req->data_count; i++)
+    {
+        memcpy( ptr, req->data[i].ptr, req->data[i].size );
+        ptr += req->data[i].size;
+    }
+
+    /* the server sets server_idle before checking the buffers a last time,
+     * so either it sees our request or we see that it needs to be woken up */
+    __atomic_store_n( &shm->state, REQUEST_SHM_REQUEST, __ATOMIC_SEQ_CST );
+    if (__atomic_load_n( &request_shm_control->server_idle, __ATOMIC_SEQ_CST ))
+        write( request_shm_doorbell, &doorbell, sizeof(doorbell) );
+
+    if (wait_shm_reply( shm ) == REQUEST_SHM_CLOSED) abort_thread(0);  /* the server killed the thread */
+
+    ptr = (char *)(shm + 1);
+    memcpy( &req->u.reply, ptr, sizeof(req->u.reply) );
     if (req->u.reply.reply_header.reply_size)
-        read_reply_data( req->reply_data, req->u.reply.reply_header.reply_size );
+        memcpy( req->reply_data, ptr + sizeof(req->u.reply), req->u.reply.reply_header.reply_size );
+    __atomic_store_n( &shm->state, REQUEST_SHM_IDLE, __ATOMIC_RELAXED );
     return req->u.reply.reply_header.error;
 }
 
+#endif  /* __linux__ */
+
 
 /***********************************************************************
  *           server_call_unlocked
@@ -290,6 +411,11 @@ unsigned int server_call_unlocked( void *req_ptr )
     struct __server_request_info * const req = req_ptr;
     unsigned int ret;
 
+#ifdef __linux__
+    request_shm_t *shm = ntdll_get_thread_data()->request_shm;
+
+    if (shm && can_use_request_shm( req )) return server_call_shm( shm, req );
+#endif
     if ((ret = send_request( req ))) return ret;
     return wait_reply( req );
 }
@@ -1165,6 +1291,8 @@ int server_get_unix_fd( HANDLE handle, unsigned int wanted_access, int *unix_fd,
     *needs_close = 0;
     wanted_access &= FILE_READ_DATA | FILE_WRITE_DATA | FILE_APPEND_DATA;
 
+    if (!handle) return STATUS_INVALID_HANDLE;
+
     ret = get_cached_fd( handle, &fd, type, &access, options );
     if (ret != STATUS_INVALID_HANDLE) goto done;
 
@@ -1633,6 +1761,13 @@ size_t server_init_process(void)
     sigaddset( &server_block_set, SIGCHLD );
     pthread_sigmask( SIG_BLOCK, &server_block_set, NULL );
 
+#ifdef __linux__
+    {
+        const char *env = getenv( "WINE_SHM_REQUESTS" );
+        use_request_shm = env && atoi( env );
+    }
+#endif
+
     /* receive the first thread request fd on the main socket */
     data->request_fd = wine_server_receive_fd( &version );
 
@@ -1725,6 +1860,68 @@ size_t server_init_process(void)
 }
 
 
+/***********************************************************************
+ *           init_request_shm
+ *
+ * Get a shared memory buffer to pass the requests of the current thread.
+ */
+static void init_request_shm(void)
+{
+#ifdef __linux__
+    struct ntdll_thread_data *thread_data = ntdll_get_thread_data();
+    int buffer_fd = -1, control_fd = -1, doorbell_fd = -1;
+    obj_handle_t token;
+    unsigned int status;
+    sigset_t sigset;
+    void *ptr;
+
+    if (!use_request_shm) return;
+
+    server_enter_uninterrupted_section( &fd_cache_mutex, &sigset );
+
+    SERVER_START_REQ( get_request_shm )
+    {
+        if (!(status = server_call_unlocked( req )))
+        {
+            buffer_fd = wine_server_receive_fd( &token );
+            assert( token == reply->buffer );
+            control_fd = wine_server_receive_fd( &token );
+            assert( token == reply->control );
+            doorbell_fd = wine_server_receive_fd( &token );
+            assert( token == reply->doorbell );
+        }
+    }
+    SERVER_END_REQ;
+
+    if (!status && !request_shm_control)
+    {
+        /* the control page and the doorbell are the same for all the threads */
+        if ((ptr = mmap( NULL, sizeof(*request_shm_control), PROT_READ | PROT_WRITE,
+                         MAP_SHARED, control_fd, 0 )) != MAP_FAILED)
+        {
+            request_shm_control = ptr;
+            request_shm_doorbell = doorbell_fd;
+            doorbell_fd = -1;
+        }
+    }
+    if (!status && request_shm_control)
+    {
+        if ((ptr = mmap( NULL, REQUEST_SHM_SIZE, PROT_READ | PROT_WRITE,
+                         MAP_SHARED, buffer_fd, 0 )) != MAP_FAILED)
+            thread_data->request_shm = ptr;
+    }
+
+    server_leave_uninterrupted_section( &fd_cache_mutex, &sigset );
+
+    if (status) WARN( "failed to get request buffer, status %#x\n", status );
+    else if (!thread_data->request_shm) WARN( "failed to map request buffer: %s\n", strerror( errno ));
+    if (buffer_fd != -1) close( buffer_fd );
+    if (control_fd != -1) close( control_fd );
+    if (doorbell_fd != -1) close( doorbell_fd );
+#endif
+}
+
+
 /***********************************************************************
  *           server_init_process_done
  */
@@ -1754,6 +1951,8 @@ void server_init_process_done(void)
     /* always send the native TEB */
     if (!(teb = NtCurrentTeb64())) teb = NtCurrentTeb();
 
+    init_request_shm();
+
     /* Signal the parent process to continue */
     SERVER_START_REQ( init_process_done )
     {
@@ -1794,6 +1993,8 @@ void server_init_thread( void *entry_point, BOOL *suspend )
     }
     SERVER_END_REQ;
     close( reply_pipe );
+
+    init_request_shm();
 }
 
 NTSTATUS WINAPI NtAllocateReserveObject( HANDLE *handle, const OBJECT_ATTRIBUTES *attr,
@@ -1931,6 +2132,9 @@ NTSTATUS WINAPI NtClose( HANDLE handle )
     if (HandleToLong( handle ) >= ~5 && HandleToLong( handle ) <= ~0)
         return STATUS_SUCCESS;
 
+    /* a null handle can never be valid, no need to ask the server */
+    if (!handle) return STATUS_INVALID_HANDLE;
+
     /* hold fd_cache_mutex to prevent the fd from being added again between the
      * call to remove_fd_from_cache and close_handle */
     server_enter_uninterrupted_section( &fd_cache_mutex, &sigset );
@@ -1951,7 +2155,7 @@ NTSTATUS WINAPI NtClose( HANDLE handle )
 
     if (fd != -1) close( fd );
 
-    if (ret != STATUS_INVALID_HANDLE || !handle) return ret;
+    if (ret != STATUS_INVALID_HANDLE) return ret;
     if (!peb->BeingDebugged) return ret;
     if (!NtQueryInformationProcess( NtCurrentProcess(), ProcessDebugPort, &port, sizeof(port), NULL) && port)
     {
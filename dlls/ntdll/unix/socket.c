@@ -42,6 +42,12 @@
 #ifdef HAVE_NETINET_TCP_H
 # include <netinet/tcp.h>
 #endif
+#ifdef HAVE_NETINET_UDP_H
+# include <netinet/udp.h>
+#endif
+#ifdef HAVE_SYS_SENDFILE_H
+# include <sys/sendfile.h>
+#endif
 
 #ifdef HAVE_NETIPX_IPX_H
 # include <netipx/ipx.h>
@@ -1043,11 +1049,12 @@ static NTSTATUS try_send( int fd, struct async_send_ioctl *async )
     union unix_sockaddr unix_addr;
     struct msghdr hdr;
     int attempt = 0;
-    int sock_type;
+    int sock_type = 0;
     socklen_t len = sizeof(sock_type);
     ssize_t ret;
 
-    getsockopt(fd, SOL_SOCKET, SO_TYPE, &sock_type, &len);
+    /* the socket type only matters when sending to an explicit address */
+    if (async->addr) getsockopt( fd, SOL_SOCKET, SO_TYPE, &sock_type, &len );
 
     memset( &hdr, 0, sizeof(hdr) );
     if (async->addr && sock_type != SOCK_STREAM)
@@ -1362,6 +1369,48 @@ static ssize_t do_send( int fd, const void *buffer, size_t len, int flags )
     return ret;
 }
 
+#ifdef HAVE_SYS_SENDFILE_H
+/* send the file data without copying it through the transmit buffer;
+ * returns STATUS_NOT_SUPPORTED if sendfile() can't be used for this file */
+static NTSTATUS try_sendfile( int sock_fd, int file_fd, struct async_transmit_ioctl *async )
+{
+    ssize_t ret;
+    off_t offset;
+
+    while (async->file)
+    {
+        size_t count = 0x7ffff000;
+
+        if (async->file_len) count = min( count, async->file_len - async->file_cursor );
+
+        TRACE( "sending %zu bytes of file data\n", count );
+        if (async->offset.QuadPart == FILE_USE_FILE_POINTER_POSITION)
+            ret = sendfile( sock_fd, file_fd, NULL, count );
+        else
+        {
+            offset = async->offset.QuadPart;
+            ret = sendfile( sock_fd, file_fd, &offset, count );
+        }
+        if (ret < 0)
+        {
+            if (errno == EINTR) continue;
+            if (errno == EINVAL || errno == ENOSYS) return STATUS_NOT_SUPPORTED;
+            if (errno != EWOULDBLOCK) WARN( "sendfile: %s\n", strerror( errno ) );
+            return sock_errno_to_status( errno );
+        }
+        TRACE( "sendfile returned %zd\n", ret );
+
+        async->file_cursor += ret;
+        if (async->offset.QuadPart != FILE_USE_FILE_POINTER_POSITION)
+            async->offset.QuadPart += ret;
+
+        if (!ret || (async->file_len && async->file_cursor == async->file_len))
+            async->file = NULL;
+    }
+    return STATUS_SUCCESS;
+}
+#endif
+
 static NTSTATUS try_transmit( int sock_fd, int file_fd, struct async_transmit_ioctl *async )
 {
     ssize_t ret;
@@ -1387,6 +1436,14 @@ static NTSTATUS try_transmit( int sock_fd, int file_fd, struct async_transmit_io
         async->file_cursor += ret;
     }
 
+#ifdef HAVE_SYS_SENDFILE_H
+    if (async->file && async->buffer_cursor == async->read_len)
+    {
+        NTSTATUS status = try_sendfile( sock_fd, file_fd, async );
+        if (status && status != STATUS_NOT_SUPPORTED) return status;
+    }
+#endif
+
     if (async->file && async->buffer_cursor == async->read_len)
     {
         unsigned int read_size = async->buffer_size;
@@ -2657,6 +2714,15 @@ NTSTATUS sock_ioctl( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, void *apc
         case IOCTL_AFD_WINE_SET_TCP_KEEPCNT:
             return do_setsockopt( handle, io, IPPROTO_TCP, TCP_KEEPCNT, in_buffer, in_size );
 
+#ifdef UDP_SEGMENT
+        /* UDP send segmentation offload is called UDP_SEGMENT on Linux */
+        case IOCTL_AFD_WINE_GET_UDP_SEND_MSG_SIZE:
+            return do_getsockopt( handle, io, IPPROTO_UDP, UDP_SEGMENT, out_buffer, out_size );
+
+        case IOCTL_AFD_WINE_SET_UDP_SEND_MSG_SIZE:
+            return do_setsockopt( handle, io, IPPROTO_UDP, UDP_SEGMENT, in_buffer, in_size );
+#endif
+
         default:
         {
             if ((code >> 16) == FILE_DEVICE_NETWORK)
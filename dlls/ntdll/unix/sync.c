@@ -630,7 +630,7 @@ static void release_inproc_sync( struct inproc_sync *sync )
     LONG ref = InterlockedDecrement( &sync->refcount );
 
     assert( ref >= 0 );
-    if (!ref) close( fd );
+    if (!ref && fd != -1) close( fd );
 }
 
 static struct inproc_sync *get_cached_inproc_sync( HANDLE handle )
@@ -677,6 +677,17 @@ static NTSTATUS get_server_inproc_sync( HANDLE handle, struct inproc_sync *sync
             sync->type = reply->type;
             sync->closed = 0;
         }
+        else if (ret == STATUS_NOT_IMPLEMENTED)
+        {
+            /* remember that the object has no in-process sync, so that
+             * we don't ask the server again on every wait */
+            sync->refcount = 1;
+            sync->fd = -1;
+            sync->access = 0;
+            sync->type = INPROC_SYNC_UNKNOWN;
+            sync->closed = 0;
+            ret = STATUS_SUCCESS;
+        }
     }
     SERVER_END_REQ;
 
@@ -718,6 +729,11 @@ static NTSTATUS get_inproc_sync( HANDLE handle, enum inproc_sync_type desired_ty
         server_leave_uninterrupted_section( &fd_cache_mutex, &sigset );
     }
 
+    if (sync->type == INPROC_SYNC_UNKNOWN)
+    {
+        release_inproc_sync( sync );
+        return STATUS_NOT_IMPLEMENTED;
+    }
     if (desired_type != INPROC_SYNC_UNKNOWN && desired_type != sync->type)
     {
         release_inproc_sync( sync );
@@ -1109,6 +1109,8 @@ static DECLSPEC_NORETURN void pthread_exit_wrapper( int status )
     close( ntdll_get_thread_data()->wait_fd[1] );
     close( ntdll_get_thread_data()->reply_fd );
     close( ntdll_get_thread_data()->request_fd );
+    if (ntdll_get_thread_data()->request_shm)
+        munmap( (void *)ntdll_get_thread_data()->request_shm, REQUEST_SHM_SIZE );
     pthread_exit( UIntToPtr(status) );
 }
 
@@ -198,6 +198,7 @@ static void *working_set_limit   = (void *)0x7fff0000;
 #endif
 
 static void *host_addr_space_limit;  /* top of the host virtual address space */
+static SIZE_T large_page_size = 2 * 1024 * 1024;  /* size of the pages used for MEM_LARGE_PAGES */
 
 static struct file_view *arm64ec_view;
 
@@ -235,6 +236,7 @@ static int uffd_fd, pagemap_fd;
 #endif
 
 static struct file_view *view_block_start, *view_block_end, *next_free_view;
+static struct file_view *last_found_view;  /* cache for find_view lookups */
 static const size_t view_block_size = 0x100000;
 static void *preload_reserve_start;
 static void *preload_reserve_end;
@@ -1440,17 +1442,25 @@ static void VIRTUAL_Dump(void)
 static struct file_view *find_view( const void *addr, size_t size )
 {
     struct wine_rb_entry *ptr = views_tree.root;
+    struct file_view *view = last_found_view;
 
     if ((const char *)addr + size < (const char *)addr) return NULL; /* overflow */
 
+    /* consecutive lookups very often hit the same view, try it before walking the tree */
+    if (view && view->base <= addr && (const char *)view->base + view->size > (const char *)addr)
+    {
+        if ((const char *)view->base + view->size < (const char *)addr + size) return NULL;  /* size too large */
+        return view;
+    }
+
     while (ptr)
     {
-        struct file_view *view = WINE_RB_ENTRY_VALUE( ptr, struct file_view, entry );
+        view = WINE_RB_ENTRY_VALUE( ptr, struct file_view, entry );
 
         if (view->base > addr) ptr = ptr->left;
         else if ((const char *)view->base + view->size <= (const char *)addr) ptr = ptr->right;
         else if ((const char *)view->base + view->size < (const char *)addr + size) break;  /* size too large */
-        else return view;
+        else return last_found_view = view;
     }
     return NULL;
 }
@@ -1779,6 +1789,7 @@ static void unregister_view( struct file_view *view )
     if (mmap_is_in_reserved_area( view->base, view->size ))
         free_ranges_remove_view( view );
     wine_rb_remove( &views_tree, &view->entry );
+    if (last_found_view == view) last_found_view = NULL;
 }
 
 
@@ -3647,6 +3658,26 @@ static void *alloc_virtual_heap( SIZE_T size )
     return anon_mmap_alloc( size, PROT_READ | PROT_WRITE );
 }
 
+/***********************************************************************
+ *           init_large_page_size
+ *
+ * Retrieve the size of the host huge pages, used to back MEM_LARGE_PAGES allocations.
+ */
+static void init_large_page_size(void)
+{
+#ifdef __linux__
+    unsigned long size;
+    FILE *f;
+
+    if (!(f = fopen( "/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", "r" ))) return;
+    if (fscanf( f, "%lu", &size ) == 1 && size > host_page_size && !(size & (size - 1)))
+        large_page_size = size;
+    fclose( f );
+#endif
+    TRACE( "large page size: %uk\n", (UINT)(large_page_size / 1024) );
+}
+
+
 /***********************************************************************
  *           virtual_init
  */
@@ -3677,6 +3708,7 @@ void virtual_init(void)
 #endif
 
     kernel_writewatch_init();
+    init_large_page_size();
 
     if (preload_info && *preload_info)
         for (i = 0; (*preload_info)[i].size; i++)
@@ -4459,7 +4491,7 @@ void virtual_init_user_shared_data(void)
     virtual_get_system_info( &info, FALSE );
 
     data->TickCountMultiplier   = 1 << 24;
-    data->LargePageMinimum      = 2 * 1024 * 1024;
+    data->LargePageMinimum      = large_page_size;
     data->SystemCall            = 1;
     data->NumberOfPhysicalPages = info.MmNumberOfPhysicalPages;
     data->NXSupportPolicy       = NX_SUPPORT_POLICY_OPTIN;
@@ -5056,6 +5088,32 @@ void virtual_set_large_address_space(void)
 }
 
 
+/***********************************************************************
+ *             has_lock_memory_privilege
+ *
+ * Check whether the caller holds the privilege needed for MEM_LARGE_PAGES.
+ */
+static BOOL has_lock_memory_privilege(void)
+{
+    PRIVILEGE_SET privs;
+    BOOLEAN ret = FALSE;
+    HANDLE token;
+
+    if (NtOpenThreadToken( NtCurrentThread(), TOKEN_QUERY, TRUE, &token ) &&
+        NtOpenProcessToken( NtCurrentProcess(), TOKEN_QUERY, &token ))
+        return FALSE;
+
+    privs.PrivilegeCount = 1;
+    privs.Control = PRIVILEGE_SET_ALL_NECESSARY;
+    privs.Privilege[0].Luid.LowPart = SE_LOCK_MEMORY_PRIVILEGE;
+    privs.Privilege[0].Luid.HighPart = 0;
+    privs.Privilege[0].Attributes = 0;
+    if (NtPrivilegeCheck( token, &privs, &ret )) ret = FALSE;
+    NtClose( token );
+    return ret;
+}
+
+
 /***********************************************************************
  *             allocate_virtual_memory
  *
@@ -5113,6 +5171,17 @@ static NTSTATUS allocate_virtual_memory( void **ret, SIZE_T *size_ptr, ULONG typ
     if (type & MEM_RESERVE_PLACEHOLDER && (protect != PAGE_NOACCESS)) return STATUS_INVALID_PARAMETER;
     if (!arm64ec_view && (attributes & MEM_EXTENDED_PARAMETER_EC_CODE)) return STATUS_INVALID_PARAMETER;
 
+    if (type & MEM_LARGE_PAGES)
+    {
+        /* large pages are reserved and committed at once, in multiples of the large page size */
+        if ((type & (MEM_RESERVE | MEM_COMMIT)) != (MEM_RESERVE | MEM_COMMIT)) return STATUS_INVALID_PARAMETER;
+        if (type & (MEM_WRITE_WATCH | MEM_RESERVE_PLACEHOLDER | MEM_REPLACE_PLACEHOLDER))
+            return STATUS_INVALID_PARAMETER;
+        if (((UINT_PTR)base | size) & (large_page_size - 1)) return STATUS_INVALID_PARAMETER;
+        if (!has_lock_memory_privilege()) return STATUS_PRIVILEGE_NOT_HELD;
+        if (align < large_page_size) align = large_page_size;
+    }
+
     /* Reserve the memory */
 
     server_enter_uninterrupted_section( &virtual_mutex, &sigset );
@@ -5132,6 +5201,9 @@ static NTSTATUS allocate_virtual_memory( void **ret, SIZE_T *size_ptr, ULONG typ
                                     align ? align - 1 : granularity_mask );
 
             if (status == STATUS_SUCCESS) base = view->base;
+#ifdef MADV_HUGEPAGE
+            if (status == STATUS_SUCCESS && (type & MEM_LARGE_PAGES)) madvise( base, size, MADV_HUGEPAGE );
+#endif
         }
     }
     else if (type & MEM_RESET)
@@ -5186,7 +5258,8 @@ static NTSTATUS allocate_virtual_memory( void **ret, SIZE_T *size_ptr, ULONG typ
 NTSTATUS WINAPI NtAllocateVirtualMemory( HANDLE process, PVOID *ret, ULONG_PTR zero_bits,
                                          SIZE_T *size_ptr, ULONG type, ULONG protect )
 {
-    static const ULONG type_mask = MEM_COMMIT | MEM_RESERVE | MEM_TOP_DOWN | MEM_WRITE_WATCH | MEM_RESET;
+    static const ULONG type_mask = MEM_COMMIT | MEM_RESERVE | MEM_TOP_DOWN | MEM_WRITE_WATCH | MEM_RESET
+                                   | MEM_LARGE_PAGES;
     ULONG_PTR limit;
 
     TRACE("%p %p %08lx %x %08x\n", process, *ret, *size_ptr, type, protect );
@@ -5326,7 +5399,8 @@ NTSTATUS WINAPI NtAllocateVirtualMemoryEx( HANDLE process, PVOID *ret, SIZE_T *s
                                            ULONG count )
 {
     static const ULONG type_mask = MEM_COMMIT | MEM_RESERVE | MEM_TOP_DOWN | MEM_WRITE_WATCH
-                                   | MEM_RESET | MEM_RESERVE_PLACEHOLDER | MEM_REPLACE_PLACEHOLDER;
+                                   | MEM_RESET | MEM_RESERVE_PLACEHOLDER | MEM_REPLACE_PLACEHOLDER
+                                   | MEM_LARGE_PAGES;
     ULONG_PTR limit_low = 0;
     ULONG_PTR limit_high = 0;
     ULONG_PTR align = 0;
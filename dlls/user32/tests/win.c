@@ -13139,6 +13139,7 @@ static void other_process_proc(HWND hwnd)
 {
     HANDLE window_ready_event, test_done_event;
     WINDOWPLACEMENT wp = {0};
+    LONG style;
     DWORD ret;
 
     window_ready_event = OpenEventA(EVENT_ALL_ACCESS, FALSE, "test_opw_window");
@@ -13153,6 +13154,8 @@ static void other_process_proc(HWND hwnd)
     ok(ret, "Unexpected ret %#lx.\n", ret);
     ok(wp.showCmd == SW_SHOWNORMAL, "Unexpected showCmd %#x.\n", wp.showCmd);
     ok(!wp.flags, "Unexpected flags %#x.\n", wp.flags);
+    style = GetWindowLongA(hwnd, GWL_STYLE);
+    ok((style & (WS_VISIBLE | WS_MAXIMIZE | WS_MINIMIZE)) == WS_VISIBLE, "Unexpected style %#lx.\n", style);
     SetEvent(test_done_event);
 
     /* SW_SHOWMAXIMIZED */
@@ -13162,6 +13165,9 @@ static void other_process_proc(HWND hwnd)
     ok(ret, "Unexpected ret %#lx.\n", ret);
     ok(wp.showCmd == SW_SHOWMAXIMIZED, "Unexpected showCmd %#x.\n", wp.showCmd);
     todo_wine ok(wp.flags == WPF_RESTORETOMAXIMIZED, "Unexpected flags %#x.\n", wp.flags);
+    style = GetWindowLongA(hwnd, GWL_STYLE);
+    ok((style & (WS_VISIBLE | WS_MAXIMIZE | WS_MINIMIZE)) == (WS_VISIBLE | WS_MAXIMIZE),
+       "Unexpected style %#lx.\n", style);
     SetEvent(test_done_event);
 
     /* SW_SHOWMINIMIZED */
@@ -13171,6 +13177,9 @@ static void other_process_proc(HWND hwnd)
     ok(ret, "Unexpected ret %#lx.\n", ret);
     ok(wp.showCmd == SW_SHOWMINIMIZED, "Unexpected showCmd %#x.\n", wp.showCmd);
     todo_wine ok(wp.flags == WPF_RESTORETOMAXIMIZED, "Unexpected flags %#x.\n", wp.flags);
+    style = GetWindowLongA(hwnd, GWL_STYLE);
+    ok((style & (WS_VISIBLE | WS_MAXIMIZE | WS_MINIMIZE)) == (WS_VISIBLE | WS_MINIMIZE),
+       "Unexpected style %#lx.\n", style);
     SetEvent(test_done_event);
 
     /* SW_RESTORE */
@@ -13180,6 +13189,33 @@ static void other_process_proc(HWND hwnd)
     ok(ret, "Unexpected ret %#lx.\n", ret);
     ok(wp.showCmd == SW_SHOWMAXIMIZED, "Unexpected showCmd %#x.\n", wp.showCmd);
     todo_wine ok(wp.flags == WPF_RESTORETOMAXIMIZED, "Unexpected flags %#x.\n", wp.flags);
+    style = GetWindowLongA(hwnd, GWL_STYLE);
+    ok((style & (WS_VISIBLE | WS_MAXIMIZE | WS_MINIMIZE)) == (WS_VISIBLE | WS_MAXIMIZE),
+       "Unexpected style %#lx.\n", style);
+    SetEvent(test_done_event);
+
+    /* SetWindowLong */
+    ret = WaitForSingleObject(window_ready_event, 5000);
+    ok(ret == WAIT_OBJECT_0, "Unexpected ret %lx.\n", ret);
+    style = GetWindowLongA(hwnd, GWL_STYLE);
+    ok(style & WS_BORDER, "Unexpected style %#lx.\n", style);
+    style = GetWindowLongA(hwnd, GWL_EXSTYLE);
+    ok(style & WS_EX_TOOLWINDOW, "Unexpected exstyle %#lx.\n", style);
+    ok(!(style & WS_EX_TOPMOST), "Unexpected exstyle %#lx.\n", style);
+    SetEvent(test_done_event);
+
+    /* SetWindowPos HWND_TOPMOST */
+    ret = WaitForSingleObject(window_ready_event, 5000);
+    ok(ret == WAIT_OBJECT_0, "Unexpected ret %lx.\n", ret);
+    style = GetWindowLongA(hwnd, GWL_EXSTYLE);
+    ok(style & WS_EX_TOPMOST, "Unexpected exstyle %#lx.\n", style);
+    SetEvent(test_done_event);
+
+    /* SW_HIDE */
+    ret = WaitForSingleObject(window_ready_event, 5000);
+    ok(ret == WAIT_OBJECT_0, "Unexpected ret %lx.\n", ret);
+    style = GetWindowLongA(hwnd, GWL_STYLE);
+    ok(!(style & WS_VISIBLE), "Unexpected style %#lx.\n", style);
     SetEvent(test_done_event);
 
     CloseHandle(window_ready_event);
@@ -13274,6 +13310,24 @@ static void test_other_process_window(const char *argv0)
     ret = WaitForSingleObject(test_done_event, 5000);
     ok(ret == WAIT_OBJECT_0, "Unexpected ret %x.\n", ret);
 
+    SetWindowLongA(hwnd, GWL_STYLE, GetWindowLongA(hwnd, GWL_STYLE) | WS_BORDER);
+    SetWindowLongA(hwnd, GWL_EXSTYLE, GetWindowLongA(hwnd, GWL_EXSTYLE) | WS_EX_TOOLWINDOW);
+    SetEvent(window_ready_event);
+    ret = WaitForSingleObject(test_done_event, 5000);
+    ok(ret == WAIT_OBJECT_0, "Unexpected ret %x.\n", ret);
+
+    ret = SetWindowPos(hwnd, HWND_TOPMOST, 0, 0, 0, 0, SWP_NOMOVE | SWP_NOSIZE | SWP_NOACTIVATE);
+    ok(ret, "Unexpected ret %#x.\n", ret);
+    SetEvent(window_ready_event);
+    ret = WaitForSingleObject(test_done_event, 5000);
+    ok(ret == WAIT_OBJECT_0, "Unexpected ret %x.\n", ret);
+
+    ret = ShowWindow(hwnd, SW_HIDE);
+    ok(ret, "Unexpected ret %#x.\n", ret);
+    SetEvent(window_ready_event);
+    ret = WaitForSingleObject(test_done_event, 5000);
+    ok(ret == WAIT_OBJECT_0, "Unexpected ret %x.\n", ret);
+
     wait_child_process(&info);
     CloseHandle(window_ready_event);
     CloseHandle(test_done_event);
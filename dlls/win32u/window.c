@@ -1033,6 +1033,19 @@ UINT get_window_dpi_awareness_context( HWND hwnd )
     return ctx;
 }
 
+/* retrieve the window style or extended style from the window shared memory */
+static BOOL get_shared_window_style( HWND hwnd, INT offset, LONG_PTR *style )
+{
+    struct object_lock lock = OBJECT_LOCK_INIT;
+    const window_shm_t *window_shm = NULL;
+    NTSTATUS status;
+
+    while ((status = get_shared_window( hwnd, &lock, &window_shm )) == STATUS_PENDING)
+        *style = offset == GWL_STYLE ? window_shm->style : window_shm->ex_style;
+
+    return !status;
+}
+
 /* see GetDpiForWindow */
 UINT get_dpi_for_window( HWND hwnd )
 {
@@ -1154,6 +1167,8 @@ static LONG_PTR get_window_long_size( HWND hwnd, INT offset, UINT size, BOOL ans
             RtlSetLastWin32Error( ERROR_ACCESS_DENIED );
             return 0;
         }
+        if ((offset == GWL_STYLE || offset == GWL_EXSTYLE) && get_shared_window_style( hwnd, offset, &retval ))
+            return retval;
         SERVER_START_REQ( get_window_info )
         {
             req->handle = wine_server_user_handle( hwnd );
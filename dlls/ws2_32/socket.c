@@ -327,6 +327,16 @@ static inline const char *debugstr_sockopt(int level, int optname)
         }
         break;
 
+        DEBUG_SOCKLEVEL(IPPROTO_UDP);
+        switch(optname)
+        {
+            DEBUG_SOCKOPT(UDP_CHECKSUM_COVERAGE);
+            DEBUG_SOCKOPT(UDP_NOCHECKSUM);
+            DEBUG_SOCKOPT(UDP_RECV_MAX_COALESCED_SIZE);
+            DEBUG_SOCKOPT(UDP_SEND_MSG_SIZE);
+        }
+        break;
+
         DEBUG_SOCKLEVEL(IPPROTO_IP);
         switch(optname)
         {
@@ -2018,6 +2028,25 @@ int WINAPI getsockopt( SOCKET s, int level, int optname, char *optval, int *optl
             return -1;
         }
 
+    case IPPROTO_UDP:
+        switch(optname)
+        {
+        case UDP_SEND_MSG_SIZE:
+            if (*optlen < sizeof(DWORD) || !optval)
+            {
+                *optlen = 0;
+                SetLastError( WSAEFAULT );
+                return SOCKET_ERROR;
+            }
+            *optlen = sizeof(DWORD);
+            return server_getsockopt( s, IOCTL_AFD_WINE_GET_UDP_SEND_MSG_SIZE, optval, optlen );
+
+        default:
+            FIXME( "unrecognized UDP option %#x\n", optname );
+            SetLastError( WSAENOPROTOOPT );
+            return SOCKET_ERROR;
+        }
+
     case IPPROTO_IP:
         switch(optname)
         {
@@ -3457,6 +3486,31 @@ int WINAPI setsockopt( SOCKET s, int level, int optname, const char *optval, int
         }
         break;
 
+    case IPPROTO_UDP:
+        if (optlen < 0)
+        {
+            SetLastError(WSAENOBUFS);
+            return SOCKET_ERROR;
+        }
+
+        switch(optname)
+        {
+        case UDP_SEND_MSG_SIZE:
+            if (optlen < sizeof(DWORD) || !optval)
+            {
+                SetLastError( WSAEFAULT );
+                return SOCKET_ERROR;
+            }
+            value = *(DWORD*)optval;
+            return server_setsockopt( s, IOCTL_AFD_WINE_SET_UDP_SEND_MSG_SIZE, (char*)&value, sizeof(value) );
+
+        default:
+            FIXME("Unknown IPPROTO_UDP optname 0x%08x\n", optname);
+            SetLastError(WSAENOPROTOOPT);
+            return SOCKET_ERROR;
+        }
+        break;
+
     case IPPROTO_IP:
         if (optlen < 0)
         {
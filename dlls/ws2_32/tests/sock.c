@@ -2114,6 +2114,87 @@ static void test_set_getsockopt(void)
     }
 }
 
+static void test_udp_send_msg_size(void)
+{
+    DWORD value;
+    SOCKET s;
+    int size;
+    int err;
+
+    s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    ok(s != INVALID_SOCKET, "failed to create socket, error %u\n", WSAGetLastError());
+
+    size = sizeof(value);
+    value = 0xdeadbeef;
+    err = getsockopt(s, IPPROTO_UDP, UDP_SEND_MSG_SIZE, (char *)&value, &size);
+    if (err)
+    {
+        /* UDP send offload is supported since Windows 10 2004, and Wine needs
+         * UDP_SEGMENT support from the host */
+        skip("UDP_SEND_MSG_SIZE is not supported, error %u\n", WSAGetLastError());
+        closesocket(s);
+        return;
+    }
+    ok(!value, "got %lu\n", value);
+    ok(size == sizeof(value), "got size %d\n", size);
+
+    value = 1000;
+    err = setsockopt(s, IPPROTO_UDP, UDP_SEND_MSG_SIZE, (char *)&value, sizeof(value));
+    ok(!err, "got error %u\n", WSAGetLastError());
+
+    size = sizeof(value);
+    value = 0xdeadbeef;
+    err = getsockopt(s, IPPROTO_UDP, UDP_SEND_MSG_SIZE, (char *)&value, &size);
+    ok(!err, "got error %u\n", WSAGetLastError());
+    ok(value == 1000, "got %lu\n", value);
+
+    WSASetLastError(0xdeadbeef);
+    err = setsockopt(s, IPPROTO_UDP, UDP_SEND_MSG_SIZE, (char *)&value, sizeof(value) - 1);
+    ok(err == SOCKET_ERROR, "got %d\n", err);
+    ok(WSAGetLastError() == WSAEFAULT, "got error %u\n", WSAGetLastError());
+
+    WSASetLastError(0xdeadbeef);
+    err = setsockopt(s, IPPROTO_UDP, UDP_SEND_MSG_SIZE, (char *)&value, -1);
+    ok(err == SOCKET_ERROR, "got %d\n", err);
+    ok(WSAGetLastError() == WSAENOBUFS || WSAGetLastError() == WSAEFAULT, "got error %u\n", WSAGetLastError());
+
+    WSASetLastError(0xdeadbeef);
+    err = setsockopt(s, IPPROTO_UDP, UDP_SEND_MSG_SIZE, NULL, sizeof(value));
+    ok(err == SOCKET_ERROR, "got %d\n", err);
+    ok(WSAGetLastError() == WSAEFAULT, "got error %u\n", WSAGetLastError());
+
+    size = sizeof(value) - 1;
+    WSASetLastError(0xdeadbeef);
+    err = getsockopt(s, IPPROTO_UDP, UDP_SEND_MSG_SIZE, (char *)&value, &size);
+    ok(err == SOCKET_ERROR, "got %d\n", err);
+    ok(WSAGetLastError() == WSAEFAULT, "got error %u\n", WSAGetLastError());
+
+    /* the failed calls didn't change the value */
+    size = sizeof(value);
+    value = 0xdeadbeef;
+    err = getsockopt(s, IPPROTO_UDP, UDP_SEND_MSG_SIZE, (char *)&value, &size);
+    ok(!err, "got error %u\n", WSAGetLastError());
+    ok(value == 1000, "got %lu\n", value);
+
+    value = 0;
+    err = setsockopt(s, IPPROTO_UDP, UDP_SEND_MSG_SIZE, (char *)&value, sizeof(value));
+    ok(!err, "got error %u\n", WSAGetLastError());
+
+    /* unknown options of a known level */
+    size = sizeof(value);
+    WSASetLastError(0xdeadbeef);
+    err = getsockopt(s, IPPROTO_UDP, 0xdead, (char *)&value, &size);
+    ok(err == SOCKET_ERROR, "got %d\n", err);
+    ok(WSAGetLastError() == WSAENOPROTOOPT, "got error %u\n", WSAGetLastError());
+
+    WSASetLastError(0xdeadbeef);
+    err = setsockopt(s, IPPROTO_UDP, 0xdead, (char *)&value, sizeof(value));
+    ok(err == SOCKET_ERROR, "got %d\n", err);
+    ok(WSAGetLastError() == WSAENOPROTOOPT, "got error %u\n", WSAGetLastError());
+
+    closesocket(s);
+}
+
 static void test_reuseaddr(void)
 {
     static struct sockaddr_in6 saddr_in6_any, saddr_in6_loopback;
@@ -14892,6 +14973,7 @@ START_TEST( sock )
     Init();
 
     test_set_getsockopt();
+    test_udp_send_msg_size();
     test_reuseaddr();
     test_ip_pktinfo();
     test_ipv4_cmsg();
@@ -1040,6 +1040,9 @@ typedef volatile struct
 {
     struct obj_locator   class;
     unsigned int         dpi_context;
+    unsigned int         style;
+    unsigned int         ex_style;
+    unsigned int         __pad;
 } window_shm_t;
 
 typedef volatile union
@@ -1063,6 +1066,28 @@ typedef volatile struct
     struct user_entry user_entries[MAX_USER_HANDLES];
 } session_shm_t;
 
+/* shared memory buffer used to pass requests and replies without the request pipes,
+ * the request or reply header and its variable size data follow this structure */
+typedef volatile struct
+{
+    int                  state;
+    int                  waiting;
+    int                  __pad[2];
+} request_shm_t;
+
+
+typedef volatile struct
+{
+    int                  server_idle;
+} request_shm_control_t;
+
+#define REQUEST_SHM_IDLE     0
+#define REQUEST_SHM_REQUEST  1
+#define REQUEST_SHM_REPLY    2
+#define REQUEST_SHM_CLOSED   3
+
+#define REQUEST_SHM_SIZE     0x10000
+
 
 
 
@@ -6154,6 +6179,22 @@ struct d3dkmt_mutex_release_reply
 };
 
 
+
+struct get_request_shm_request
+{
+    struct request_header __header;
+    char __pad_12[4];
+};
+struct get_request_shm_reply
+{
+    struct reply_header __header;
+    obj_handle_t        buffer;
+    obj_handle_t        control;
+    obj_handle_t        doorbell;
+    char __pad_20[4];
+};
+
+
 enum request
 {
     REQ_new_process,
@@ -6462,6 +6503,7 @@ enum request
     REQ_d3dkmt_object_open_name,
     REQ_d3dkmt_mutex_acquire,
     REQ_d3dkmt_mutex_release,
+    REQ_get_request_shm,
     REQ_NB_REQUESTS
 };
 
@@ -6775,6 +6817,7 @@ union generic_request
     struct d3dkmt_object_open_name_request d3dkmt_object_open_name_request;
     struct d3dkmt_mutex_acquire_request d3dkmt_mutex_acquire_request;
     struct d3dkmt_mutex_release_request d3dkmt_mutex_release_request;
+    struct get_request_shm_request get_request_shm_request;
 };
 union generic_reply
 {
@@ -7086,8 +7129,9 @@ union generic_reply
     struct d3dkmt_object_open_name_reply d3dkmt_object_open_name_reply;
     struct d3dkmt_mutex_acquire_reply d3dkmt_mutex_acquire_reply;
     struct d3dkmt_mutex_release_reply d3dkmt_mutex_release_reply;
+    struct get_request_shm_reply get_request_shm_reply;
 };
 
-#define SERVER_PROTOCOL_VERSION 927
+#define SERVER_PROTOCOL_VERSION 929
 
 #endif /* __WINE_WINE_SERVER_PROTOCOL_H */
@@ -98,6 +98,7 @@
 #include "winternl.h"
 #include "winioctl.h"
 #include "ddk/wdm.h"
+#include "wine/rbtree.h"
 
 #if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_EPOLL_CREATE)
 # include <sys/epoll.h>
@@ -333,14 +334,53 @@ static file_pos_t max_unix_offset = OFF_T_MAX;
 
 struct timeout_user
 {
-    struct list           entry;      /* entry in sorted timeout list */
+    struct rb_entry       entry;      /* entry in timeout tree */
+    struct list           expired;    /* entry in expired list while the callbacks run */
     abstime_t             when;       /* timeout expiry */
+    unsigned int          seq;        /* insertion sequence, to order identical expiry times */
     timeout_callback      callback;   /* callback function */
     void                 *private;    /* callback private data */
 };
 
-static struct list abs_timeout_list = LIST_INIT(abs_timeout_list); /* sorted absolute timeouts list */
-static struct list rel_timeout_list = LIST_INIT(rel_timeout_list); /* sorted relative timeouts list */
+struct timeout_key
+{
+    abstime_t             when;
+    unsigned int          seq;
+};
+
+/* absolute timeouts are positive and expire in increasing order, relative timeouts are
+ * negative and expire in decreasing order; in both cases the most recently added of two
+ * identical timeouts comes first */
+static int compare_abs_timeout( const void *key, const struct rb_entry *entry )
+{
+    const struct timeout_key *k = key;
+    const struct timeout_user *timeout = RB_ENTRY_VALUE( entry, const struct timeout_user, entry );
+
+    if (k->when != timeout->when) return k->when < timeout->when ? -1 : 1;
+    if (k->seq != timeout->seq) return (int)(timeout->seq - k->seq) < 0 ? -1 : 1;
+    return 0;
+}
+
+static int compare_rel_timeout( const void *key, const struct rb_entry *entry )
+{
+    const struct timeout_key *k = key;
+    const struct timeout_user *timeout = RB_ENTRY_VALUE( entry, const struct timeout_user, entry );
+
+    if (k->when != timeout->when) return k->when > timeout->when ? -1 : 1;
+    if (k->seq != timeout->seq) return (int)(timeout->seq - k->seq) < 0 ? -1 : 1;
+    return 0;
+}
+
+static struct rb_tree abs_timeout_tree = { compare_abs_timeout }; /* absolute timeouts by expiry */
+static struct rb_tree rel_timeout_tree = { compare_rel_timeout }; /* relative timeouts by expiry */
+static unsigned int timeout_seq;
+
+static inline struct timeout_user *first_timeout( const struct rb_tree *tree )
+{
+    struct rb_entry *entry = rb_head( tree->root );
+    return entry ? RB_ENTRY_VALUE( entry, struct timeout_user, entry ) : NULL;
+}
+
 timeout_t current_time;
 timeout_t monotonic_time;
 
@@ -421,39 +461,26 @@ void set_current_time(void)
 struct timeout_user *add_timeout_user( timeout_t when, timeout_callback func, void *private )
 {
     struct timeout_user *user;
-    struct list *ptr;
+    struct timeout_key key;
 
     if (!(user = mem_alloc( sizeof(*user) ))) return NULL;
     user->when     = timeout_to_abstime( when );
+    user->seq      = timeout_seq++;
     user->callback = func;
     user->private  = private;
+    list_init( &user->expired );
 
-    /* Now insert it in the linked list */
-
-    if (user->when > 0)
-    {
-        LIST_FOR_EACH( ptr, &abs_timeout_list )
-        {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
-            if (timeout->when >= user->when) break;
-        }
-    }
-    else
-    {
-        LIST_FOR_EACH( ptr, &rel_timeout_list )
-        {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
-            if (timeout->when <= user->when) break;
-        }
-    }
-    list_add_before( ptr, &user->entry );
+    key.when = user->when;
+    key.seq  = user->seq;
+    rb_put( user->when > 0 ? &abs_timeout_tree : &rel_timeout_tree, &key, &user->entry );
     return user;
 }
 
 /* remove a timeout user */
 void remove_timeout_user( struct timeout_user *user )
 {
-    list_remove( &user->entry );
+    if (!list_empty( &user->expired )) list_remove( &user->expired );
+    else rb_remove( user->when > 0 ? &abs_timeout_tree : &rel_timeout_tree, &user->entry );
     free( user );
 }
 
@@ -586,11 +613,19 @@ static inline void main_loop_epoll(void)
 
     while (active_users)
     {
+        int can_sleep = prepare_shm_requests_wait();
+
         timeout = get_next_timeout( &ts );
 
         if (!active_users) break;  /* last user removed by a timeout */
         if (epoll_fd == -1) break;  /* an error occurred with epoll */
 
+        if (!can_sleep)
+        {
+            timeout = 0;
+            ts.tv_sec = ts.tv_nsec = 0;
+        }
+
 #ifdef HAVE_EPOLL_PWAIT2
         if (!failed_epoll_pwait2)
         {
@@ -603,6 +638,7 @@ static inline void main_loop_epoll(void)
             ret = epoll_wait( epoll_fd, events, ARRAY_SIZE( events ), timeout );
 
         set_current_time();
+        end_shm_requests_wait();
 
         /* put the events into the pollfd array first, like poll does */
         for (i = 0; i < ret; i++)
@@ -889,57 +925,44 @@ static int get_next_timeout( struct timespec *ts )
 {
     timeout_t ret = user_shared_data ? user_shared_data_timeout : -1;
 
-    if (!list_empty( &abs_timeout_list ) || !list_empty( &rel_timeout_list ))
+    if (abs_timeout_tree.root || rel_timeout_tree.root)
     {
+        struct timeout_user *timeout;
         struct list expired_list, *ptr;
 
-        /* first remove all expired timers from the list */
+        /* first remove all expired timers from the trees */
 
         list_init( &expired_list );
-        while ((ptr = list_head( &abs_timeout_list )) != NULL)
+        while ((timeout = first_timeout( &abs_timeout_tree )) && timeout->when <= current_time)
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
-
-            if (timeout->when <= current_time)
-            {
-                list_remove( &timeout->entry );
-                list_add_tail( &expired_list, &timeout->entry );
-            }
-            else break;
+            rb_remove( &abs_timeout_tree, &timeout->entry );
+            list_add_tail( &expired_list, &timeout->expired );
         }
-        while ((ptr = list_head( &rel_timeout_list )) != NULL)
+        while ((timeout = first_timeout( &rel_timeout_tree )) && -timeout->when <= monotonic_time)
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
-
-            if (-timeout->when <= monotonic_time)
-            {
-                list_remove( &timeout->entry );
-                list_add_tail( &expired_list, &timeout->entry );
-            }
-            else break;
+            rb_remove( &rel_timeout_tree, &timeout->entry );
+            list_add_tail( &expired_list, &timeout->expired );
         }
 
         /* now call the callback for all the removed timers */
 
         while ((ptr = list_head( &expired_list )) != NULL)
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
-            list_remove( &timeout->entry );
+            timeout = LIST_ENTRY( ptr, struct timeout_user, expired );
+            list_remove( &timeout->expired );
             timeout->callback( timeout->private );
             free( timeout );
         }
 
-        if ((ptr = list_head( &abs_timeout_list )) != NULL)
+        if ((timeout = first_timeout( &abs_timeout_tree )))
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
             timeout_t diff = timeout->when - current_time;
             if (diff < 0) diff = 0;
             if (ret == -1 || diff < ret) ret = diff;
         }
 
-        if ((ptr = list_head( &rel_timeout_list )) != NULL)
+        if ((timeout = first_timeout( &rel_timeout_tree )))
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
             timeout_t diff = -timeout->when - monotonic_time;
             if (diff < 0) diff = 0;
             if (ret == -1 || diff < ret) ret = diff;
@@ -974,12 +997,15 @@ void main_loop(void)
 
     while (active_users)
     {
+        int can_sleep = prepare_shm_requests_wait();
+
         timeout = get_next_timeout( NULL );
 
         if (!active_users) break;  /* last user removed by a timeout */
 
-        ret = poll( pollfd, nb_users, timeout );
+        ret = poll( pollfd, nb_users, can_sleep ? timeout : 0 );
         set_current_time();
+        end_shm_requests_wait();
 
         if (ret > 0)
         {
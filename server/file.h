@@ -178,6 +178,7 @@ struct memory_view;
 
 extern void init_memory(void);
 extern int grow_file( int unix_fd, file_pos_t new_size );
+extern int create_temp_file( file_pos_t size );
 extern void free_map_addr( client_ptr_t base, mem_size_t size );
 extern struct memory_view *find_mapped_view( struct process *process, client_ptr_t base );
 extern struct memory_view *get_exe_view( struct process *process );
@@ -158,6 +158,9 @@ struct file_load_info
     int         line;     /* current input line */
     WCHAR      *tmp;      /* temp buffer to use while parsing input */
     size_t      tmplen;   /* length of temp buffer */
+    struct key **path;    /* keys for the elements of the last loaded key name */
+    int         depth;    /* number of keys in the path array */
+    int         path_size; /* allocated size of the path array */
 };
 
 
@@ -235,6 +238,9 @@ static void dump_path( const struct key *key, const struct key *base, FILE *f )
 /* dump a value to a text file */
 static void dump_value( const struct key_value *value, FILE *f )
 {
+    static const char hex[16] = "0123456789abcdef";
+    char buffer[256];
+    char *pos = buffer;
     unsigned int i, dw;
     int count;
 
@@ -272,18 +278,29 @@ static void dump_value( const struct key_value *value, FILE *f )
     else count += fprintf( f, "hex(%x):", value->type );
     for (i = 0; i < value->len; i++)
     {
-        count += fprintf( f, "%02x", *((unsigned char *)value->data + i) );
+        unsigned char ch = *((unsigned char *)value->data + i);
+
+        if (pos > buffer + sizeof(buffer) - 8)
+        {
+            fwrite( buffer, pos - buffer, 1, f );
+            pos = buffer;
+        }
+        *pos++ = hex[ch >> 4];
+        *pos++ = hex[ch & 0x0f];
+        count += 2;
         if (i < value->len-1)
         {
-            fputc( ',', f );
+            *pos++ = ',';
             if (++count > 76)
             {
-                fprintf( f, "\\\n  " );
+                memcpy( pos, "\\\n  ", 4 );
+                pos += 4;
                 count = 2;
             }
         }
     }
-    fputc( '\n', f );
+    *pos++ = '\n';
+    fwrite( buffer, pos - buffer, 1, f );
 }
 
 /* find the named child of a given key and return its index */
@@ -583,7 +600,7 @@ static int key_link_name( struct object *obj, struct object_name *name, struct o
     struct key *key = (struct key *)obj;
     struct key *parent_key = (struct key *)parent;
     struct unicode_str tmp;
-    int i, index;
+    int index;
 
     if (parent->ops != &key_ops)
     {
@@ -602,8 +619,8 @@ static int key_link_name( struct object *obj, struct object_name *name, struct o
     tmp.len = name->len;
     find_subkey( parent_key, &tmp, &index );
 
-    for (i = ++parent_key->last_subkey; i > index; i--)
-        parent_key->subkeys[i] = parent_key->subkeys[i - 1];
+    memmove( parent_key->subkeys + index + 1, parent_key->subkeys + index,
+             (++parent_key->last_subkey - index) * sizeof(*parent_key->subkeys) );
     parent_key->subkeys[index] = (struct key *)grab_object( key );
     if (is_wow6432node( name->name, name->len ) &&
         !is_wow6432node( parent_key->obj.name->name, parent_key->obj.name->len ))
@@ -615,8 +632,9 @@ static int key_link_name( struct object *obj, struct object_name *name, struct o
 static void key_unlink_name( struct object *obj, struct object_name *name )
 {
     struct key *key = (struct key *)obj;
-    struct key *parent = (struct key *)name->parent;
-    int i, nb_subkeys;
+    struct key *found, *parent = (struct key *)name->parent;
+    struct unicode_str tmp;
+    int index, nb_subkeys;
 
     if (!parent) return;
 
@@ -626,9 +644,12 @@ static void key_unlink_name( struct object *obj, struct object_name *name )
         return;
     }
 
-    for (i = 0; i <= parent->last_subkey; i++) if (parent->subkeys[i] == key) break;
-    assert( i <= parent->last_subkey );
-    for ( ; i < parent->last_subkey; i++) parent->subkeys[i] = parent->subkeys[i + 1];
+    tmp.str = name->name;
+    tmp.len = name->len;
+    found = find_subkey( parent, &tmp, &index );
+    assert( found == key );
+    memmove( parent->subkeys + index, parent->subkeys + index + 1,
+             (parent->last_subkey - index) * sizeof(*parent->subkeys) );
     parent->last_subkey--;
     name->parent = NULL;
     if (parent->wow6432node == key) parent->wow6432node = NULL;
@@ -1003,8 +1024,9 @@ static void rename_key( struct key *key, const struct unicode_str *new_name )
 {
     struct object_name *new_name_ptr;
     struct key *parent = get_parent( key );
+    struct unicode_str cur_name;
     data_size_t len;
-    int i, index, cur_index;
+    int index, cur_index;
 
     /* changing to a path is not allowed */
     len = get_path_element( new_name->str, new_name->len );
@@ -1035,17 +1057,20 @@ static void rename_key( struct key *key, const struct unicode_str *new_name )
     new_name_ptr->parent = &parent->obj;
     memcpy( new_name_ptr->name, new_name->str, new_name->len );
 
-    for (cur_index = 0; cur_index <= parent->last_subkey; cur_index++)
-        if (parent->subkeys[cur_index] == key) break;
+    cur_name.str = key->obj.name->name;
+    cur_name.len = key->obj.name->len;
+    find_subkey( parent, &cur_name, &cur_index );
 
     if (cur_index < index)
     {
         --index;
-        for (i = cur_index; i < index; ++i) parent->subkeys[i] = parent->subkeys[i+1];
+        memmove( parent->subkeys + cur_index, parent->subkeys + cur_index + 1,
+                 (index - cur_index) * sizeof(*parent->subkeys) );
     }
     else if (cur_index > index)
     {
-        for (i = cur_index; i > index; --i) parent->subkeys[i] = parent->subkeys[i-1];
+        memmove( parent->subkeys + index + 1, parent->subkeys + index,
+                 (cur_index - index) * sizeof(*parent->subkeys) );
     }
     parent->subkeys[index] = key;
 
@@ -1148,7 +1173,6 @@ static struct key_value *insert_value( struct key *key, const struct unicode_str
 {
     struct key_value *value;
     WCHAR *new_name = NULL;
-    int i;
 
     if (name->len > MAX_VALUE_LEN * sizeof(WCHAR))
     {
@@ -1160,7 +1184,8 @@ static struct key_value *insert_value( struct key *key, const struct unicode_str
         if (!grow_values( key )) return NULL;
     }
     if (name->len && !(new_name = memdup( name->str, name->len ))) return NULL;
-    for (i = ++key->last_value; i > index; i--) key->values[i] = key->values[i - 1];
+    memmove( key->values + index + 1, key->values + index,
+             (++key->last_value - index) * sizeof(*key->values) );
     value = &key->values[index];
     value->name    = new_name;
     value->namelen = name->len;
@@ -1310,7 +1335,7 @@ static void enum_value( struct key *key, int i, int info_class, struct enum_key_
 static void delete_value( struct key *key, const struct unicode_str *name )
 {
     struct key_value *value;
-    int i, index, nb_values;
+    int index, nb_values;
 
     if (key->flags & KEY_PREDEF)
     {
@@ -1326,7 +1351,8 @@ static void delete_value( struct key *key, const struct unicode_str *name )
     if (debug_level > 1) dump_operation( key, value, "Delete" );
     free( value->name );
     free( value->data );
-    for (i = index; i < key->last_value; i++) key->values[i] = key->values[i + 1];
+    memmove( key->values + index, key->values + index + 1,
+             (key->last_value - index) * sizeof(*key->values) );
     key->last_value--;
     touch_key( key, REG_NOTIFY_CHANGE_LAST_SET );
 
@@ -1447,6 +1473,71 @@ static int get_data_type( const char *buffer, int *type, int *parse_type )
     return 0;
 }
 
+/* release the keys of the cached path beyond the given depth */
+static void truncate_load_path( struct file_load_info *info, int depth )
+{
+    while (info->depth > depth) release_object( info->path[--info->depth] );
+}
+
+/* create a key relative to base, reusing the keys of the previously loaded key name */
+/* since the keys are saved in sorted order, consecutive keys usually share most of their path */
+static struct key *create_load_key( struct key *base, const struct unicode_str *name,
+                                    struct file_load_info *info )
+{
+    struct key *key, *parent = base;
+    struct unicode_str tmp;
+    const WCHAR *str = name->str;
+    data_size_t len = name->len;
+    int depth = 0;
+
+    while (len)
+    {
+        tmp.str = str;
+        tmp.len = get_path_element( str, len );
+
+        /* only reuse a key that is still a direct child of the expected parent,
+         * so that a key reached through a symlink is never taken for its target */
+        if (depth < info->depth && !(info->path[depth]->flags & KEY_DELETED) &&
+            get_parent( info->path[depth] ) == parent &&
+            tmp.len == info->path[depth]->obj.name->len &&
+            !memicmp_strW( info->path[depth]->obj.name->name, tmp.str, tmp.len ))
+        {
+            key = info->path[depth];
+        }
+        else
+        {
+            truncate_load_path( info, depth );
+            if (depth == info->path_size)
+            {
+                int size = max( 16, info->path_size * 2 );
+                struct key **path = realloc( info->path, size * sizeof(*path) );
+                if (!path)
+                {
+                    set_error( STATUS_NO_MEMORY );
+                    return NULL;
+                }
+                info->path = path;
+                info->path_size = size;
+            }
+            if (!(key = create_key_object( &parent->obj, &tmp, OBJ_OPENIF, 0, 0, NULL ))) return NULL;
+            info->path[info->depth++] = key;
+        }
+        parent = key;
+        depth++;
+
+        /* skip trailing \\ and move to the next element */
+        if (tmp.len < len)
+        {
+            tmp.len += sizeof(WCHAR);
+            str += tmp.len / sizeof(WCHAR);
+            len -= tmp.len;
+        }
+        else break;
+    }
+    truncate_load_path( info, depth );
+    return (struct key *)grab_object( parent );
+}
+
 /* load and create a key from the input file */
 static struct key *load_key( struct key *base, const char *buffer, int prefix_len,
                              struct file_load_info *info, timeout_t *modif )
@@ -1485,7 +1576,7 @@ static struct key *load_key( struct key *base, const char *buffer, int prefix_le
     }
     name.str = p;
     name.len = len - (p - info->tmp + 1) * sizeof(WCHAR);
-    return create_key_recursive( base, &name, 0 );
+    return create_load_key( base, &name, info );
 }
 
 /* update the modification time of a key (and its parents) after it has been loaded from a file */
@@ -1727,6 +1818,9 @@ static void load_keys( struct key *key, const char *filename, FILE *f, int prefi
     info.len    = 4;
     info.tmplen = 4;
     info.line   = 0;
+    info.path   = NULL;
+    info.depth  = 0;
+    info.path_size = 0;
     if (!(info.buffer = mem_alloc( info.len ))) return;
     if (!(info.tmp = mem_alloc( info.tmplen )))
     {
@@ -1781,6 +1875,8 @@ static void load_keys( struct key *key, const char *filename, FILE *f, int prefi
         update_key_time( subkey, modif );
         release_object( subkey );
     }
+    truncate_load_path( &info, 0 );
+    free( info.path );
     free( info.buffer );
     free( info.tmp );
 }
@@ -2009,6 +2105,8 @@ void init_registry(void)
 /* save a registry branch to a file */
 static void save_all_subkeys( struct key *key, FILE *f )
 {
+    /* use a large buffer to limit the number of write calls for big branches */
+    setvbuf( f, NULL, _IOFBF, 65536 );
     fprintf( f, "WINE REGISTRY Version 2\n" );
     fprintf( f, ";; All keys relative to " );
     dump_path( key, NULL, f );
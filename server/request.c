@@ -23,6 +23,7 @@
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #ifdef HAVE_PWD_H
 #include <pwd.h>
 #endif
@@ -31,6 +32,7 @@
 #include <stdlib.h>
 #include <stdarg.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/types.h>
@@ -47,6 +49,11 @@
 #ifdef __APPLE__
 # include <mach/mach_time.h>
 #endif
+#ifdef __linux__
+# include <sys/eventfd.h>
+# include <sys/syscall.h>
+# include <linux/futex.h>
+#endif
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
@@ -67,6 +74,9 @@
 #define SCM_RIGHTS 1
 #endif
 
+/* size of the request data buffer that is kept allocated between requests */
+#define MAX_CACHED_REQUEST_DATA 1024
+
 /* path names for server master Unix socket */
 static const char * const server_socket_name = "socket";   /* name of the socket file */
 static const char * const server_lock_name = "lock";       /* name of the server lock file */
@@ -117,6 +127,66 @@ static const struct fd_ops master_socket_fd_ops =
     NULL                           /* reselect_async */
 };
 
+#ifdef __linux__
+
+/* max size of the variable data that fits in a request shared memory buffer */
+#define REQUEST_SHM_DATA_SIZE (REQUEST_SHM_SIZE - sizeof(request_shm_t) - sizeof(union generic_request))
+
+struct request_doorbell
+{
+    struct object        obj;        /* object header */
+    struct fd           *fd;         /* eventfd written by the clients to wake up the server */
+};
+
+static void request_doorbell_dump( struct object *obj, int verbose );
+static void request_doorbell_destroy( struct object *obj );
+static void request_doorbell_poll_event( struct fd *fd, int event );
+
+static const struct object_ops request_doorbell_ops =
+{
+    sizeof(struct request_doorbell),  /* size */
+    &no_type,                      /* type */
+    request_doorbell_dump,         /* dump */
+    no_add_queue,                  /* add_queue */
+    NULL,                          /* remove_queue */
+    NULL,                          /* signaled */
+    NULL,                          /* satisfied */
+    no_signal,                     /* signal */
+    no_get_fd,                     /* get_fd */
+    default_get_sync,              /* get_sync */
+    default_map_access,            /* map_access */
+    default_get_sd,                /* get_sd */
+    default_set_sd,                /* set_sd */
+    no_get_full_name,              /* get_full_name */
+    no_lookup_name,                /* lookup_name */
+    no_link_name,                  /* link_name */
+    NULL,                          /* unlink_name */
+    no_open_file,                  /* open_file */
+    no_kernel_obj_list,            /* get_kernel_obj_list */
+    no_close_handle,               /* close_handle */
+    request_doorbell_destroy       /* destroy */
+};
+
+static const struct fd_ops request_doorbell_fd_ops =
+{
+    NULL,                          /* get_poll_events */
+    request_doorbell_poll_event,   /* poll_event */
+    NULL,                          /* flush */
+    NULL,                          /* get_fd_type */
+    NULL,                          /* ioctl */
+    NULL,                          /* queue_async */
+    NULL                           /* reselect_async */
+};
+
+static struct request_doorbell *request_doorbell;   /* doorbell rung by the clients when the server is idle */
+static request_shm_control_t *request_shm_control;  /* control page shared with all the clients */
+static int request_shm_control_fd = -1;             /* file descriptor of the control page */
+static struct list request_shm_threads = LIST_INIT( request_shm_threads );  /* threads using a request buffer */
+
+static void send_shm_reply( union generic_reply *reply );
+
+#endif  /* __linux__ */
+
 
 struct thread *current = NULL;  /* thread handling the current request */
 unsigned int global_error = 0;  /* global error code for when no thread is current */
@@ -251,6 +321,13 @@ static void send_reply( union generic_reply *reply )
 {
     int ret;
 
+#ifdef __linux__
+    if (current->shm_request)
+    {
+        send_shm_reply( reply );
+        return;
+    }
+#endif
     if (!current->reply_size)
     {
         if ((ret = write( get_unix_fd( current->reply_fd ),
@@ -293,6 +370,8 @@ static void call_req_handler( struct thread *thread )
 {
     union generic_reply reply;
     enum request req = thread->req.request_header.req;
+    process_id_t process = thread->process->id;
+    timeout_t start = 0;
 
     current = thread;
     current->reply_size = 0;
@@ -300,12 +379,16 @@ static void call_req_handler( struct thread *thread )
     memset( &reply, 0, sizeof(reply) );
 
     if (debug_level) trace_request();
+    if (profile_requests) start = monotonic_counter();
 
     if (req < REQ_NB_REQUESTS)
         req_handlers[req]( &current->req, &reply );
     else
         set_error( STATUS_NOT_IMPLEMENTED );
 
+    if (profile_requests)
+        profile_request( req, process, monotonic_counter() - start, current ? current->reply_size : 0 );
+
     if (current)
     {
         if (current->reply_fd)
@@ -324,30 +407,65 @@ static void call_req_handler( struct thread *thread )
     current = NULL;
 }
 
+/* release the request data buffer once the request has been handled */
+static void release_request_data( struct thread *thread )
+{
+    /* keep a small buffer around so that the next request can be read in a single syscall */
+    if (thread->req_data_max <= MAX_CACHED_REQUEST_DATA) return;
+    free( thread->req_data );
+    thread->req_data = NULL;
+    thread->req_data_max = 0;
+}
+
 /* read a request from a thread */
 void read_request( struct thread *thread )
 {
+    struct iovec vec[2];
+    data_size_t size;
     int ret;
 
     if (!thread->req_toread)  /* no pending request */
     {
-        if ((ret = read( get_unix_fd( thread->request_fd ), &thread->req,
-                         sizeof(thread->req) )) != sizeof(thread->req)) goto error;
-        if (!(thread->req_toread = thread->req.request_header.request_size))
+        /* read the variable sized data at the same time if we have room for it */
+        vec[0].iov_base = &thread->req;
+        vec[0].iov_len  = sizeof(thread->req);
+        vec[1].iov_base = thread->req_data;
+        vec[1].iov_len  = thread->req_data_max;
+
+        if ((ret = readv( get_unix_fd( thread->request_fd ), vec, 2 )) < (int)sizeof(thread->req))
+            goto error;
+        ret -= sizeof(thread->req);
+        size = thread->req.request_header.request_size;
+        if ((data_size_t)ret > size)
         {
-            /* no data, handle request at once */
-            call_req_handler( thread );
+            fatal_protocol_error( thread, "too much data for request %d (%d/%u)\n",
+                                  thread->req.request_header.req, ret, size );
             return;
         }
-        if (!(thread->req_data = malloc( thread->req_toread )))
+        if (!(thread->req_toread = size - ret))
         {
-            fatal_protocol_error( thread, "no memory for %u bytes request %d\n",
-                                  thread->req_toread, thread->req.request_header.req );
+            /* got everything, handle request at once */
+            call_req_handler( thread );
+            release_request_data( thread );
             return;
         }
+        if (size > thread->req_data_max)
+        {
+            void *data;
+
+            if (size < MAX_CACHED_REQUEST_DATA) size = MAX_CACHED_REQUEST_DATA;
+            if (!(data = realloc( thread->req_data, size )))
+            {
+                fatal_protocol_error( thread, "no memory for %u bytes request %d\n",
+                                      thread->req_toread, thread->req.request_header.req );
+                return;
+            }
+            thread->req_data = data;
+            thread->req_data_max = size;
+        }
     }
 
-    /* read the variable sized data */
+    /* read the rest of the variable sized data */
     for (;;)
     {
         ret = read( get_unix_fd( thread->request_fd ),
@@ -358,8 +476,7 @@ void read_request( struct thread *thread )
         if (!(thread->req_toread -= ret))
         {
             call_req_handler( thread );
-            free( thread->req_data );
-            thread->req_data = NULL;
+            release_request_data( thread );
             return;
         }
     }
@@ -373,6 +490,238 @@ error:
         fatal_protocol_error( thread, "read: %s\n", strerror( errno ));
 }
 
+#ifdef __linux__
+
+static void request_doorbell_dump( struct object *obj, int verbose )
+{
+    struct request_doorbell *doorbell = (struct request_doorbell *)obj;
+    assert( obj->ops == &request_doorbell_ops );
+    fprintf( stderr, "Request doorbell fd=%p\n", doorbell->fd );
+}
+
+static void request_doorbell_destroy( struct object *obj )
+{
+    struct request_doorbell *doorbell = (struct request_doorbell *)obj;
+    assert( obj->ops == &request_doorbell_ops );
+    if (doorbell->fd) release_object( doorbell->fd );
+}
+
+/* create the control page and the doorbell shared by all the request buffers */
+static int init_request_shm_control(void)
+{
+    struct request_doorbell *doorbell;
+    void *ptr;
+    int fd, efd;
+
+    if (request_shm_control) return 1;
+
+    if ((fd = create_temp_file( sizeof(*request_shm_control) )) == -1) return 0;
+    if ((ptr = mmap( NULL, sizeof(*request_shm_control), PROT_READ | PROT_WRITE,
+                     MAP_SHARED, fd, 0 )) == MAP_FAILED)
+    {
+        file_set_error();
+        close( fd );
+        return 0;
+    }
+    if ((efd = eventfd( 0, EFD_CLOEXEC | EFD_NONBLOCK )) == -1)
+    {
+        file_set_error();
+        goto error;
+    }
+    if (!(doorbell = alloc_object( &request_doorbell_ops )))
+    {
+        close( efd );
+        goto error;
+    }
+    if (!(doorbell->fd = create_anonymous_fd( &request_doorbell_fd_ops, efd, &doorbell->obj, 0 )))
+    {
+        release_object( doorbell );
+        goto error;
+    }
+    set_fd_events( doorbell->fd, POLLIN );
+
+    request_doorbell = doorbell;
+    request_shm_control = ptr;
+    request_shm_control_fd = fd;
+    return 1;
+
+error:
+    munmap( ptr, sizeof(*request_shm_control) );
+    close( fd );
+    return 0;
+}
+
+/* release the control page and the doorbell once all the clients are gone */
+static void release_request_shm_control(void)
+{
+    if (!request_shm_control) return;
+    assert( list_empty( &request_shm_threads ));
+    release_object( request_doorbell );
+    munmap( (void *)request_shm_control, sizeof(*request_shm_control) );
+    close( request_shm_control_fd );
+    request_doorbell = NULL;
+    request_shm_control = NULL;
+    request_shm_control_fd = -1;
+}
+
+/* wake the client sleeping on a request buffer state */
+static void wake_request_shm( request_shm_t *shm )
+{
+    syscall( __NR_futex, &shm->state, FUTEX_WAKE, INT_MAX, NULL, 0, 0 );
+}
+
+/* copy the reply of the current request to its shared memory buffer */
+static void send_shm_reply( union generic_reply *reply )
+{
+    request_shm_t *shm = current->request_shm;
+    char *ptr = (char *)(shm + 1);
+
+    assert( current->reply_size <= REQUEST_SHM_DATA_SIZE );
+    current->shm_request = 0;
+    memcpy( ptr, reply, sizeof(*reply) );
+    if (current->reply_size) memcpy( ptr + sizeof(*reply), current->reply_data, current->reply_size );
+    free( current->reply_data );
+    current->reply_data = NULL;
+
+    __atomic_store_n( &shm->state, REQUEST_SHM_REPLY, __ATOMIC_SEQ_CST );
+    if (__atomic_load_n( &shm->waiting, __ATOMIC_SEQ_CST )) wake_request_shm( shm );
+}
+
+/* handle a request found in a thread shared memory buffer */
+static void handle_shm_request( struct thread *thread )
+{
+    request_shm_t *shm = thread->request_shm;
+    const char *ptr = (const char *)(shm + 1);
+    data_size_t size;
+
+    memcpy( &thread->req, ptr, sizeof(thread->req) );
+    size = thread->req.request_header.request_size;
+    if (size > REQUEST_SHM_DATA_SIZE)
+    {
+        fatal_protocol_error( thread, "too much data for shared request %d (%u)\n",
+                              thread->req.request_header.req, size );
+        return;
+    }
+    /* the reply data is written back into the same buffer */
+    if (thread->req.request_header.reply_size > REQUEST_SHM_DATA_SIZE)
+    {
+        fatal_protocol_error( thread, "reply too large for shared request %d (%u)\n",
+                              thread->req.request_header.req, thread->req.request_header.reply_size );
+        return;
+    }
+    if (size > thread->req_data_max)
+    {
+        void *data;
+
+        if (size < MAX_CACHED_REQUEST_DATA) size = MAX_CACHED_REQUEST_DATA;
+        if (!(data = realloc( thread->req_data, size )))
+        {
+            fatal_protocol_error( thread, "no memory for %u bytes request %d\n",
+                                  size, thread->req.request_header.req );
+            return;
+        }
+        thread->req_data = data;
+        thread->req_data_max = size;
+    }
+    memcpy( thread->req_data, ptr + sizeof(thread->req), thread->req.request_header.request_size );
+
+    grab_object( thread );
+    thread->shm_request = 1;
+    call_req_handler( thread );
+    thread->shm_request = 0;
+    release_request_data( thread );
+    release_object( thread );
+}
+
+/* handle the requests pending in the shared memory buffers */
+static void handle_shm_requests(void)
+{
+    unsigned int count = list_count( &request_shm_threads );
+    struct thread *thread;
+    struct list *ptr;
+
+    __atomic_store_n( &request_shm_control->server_idle, 0, __ATOMIC_SEQ_CST );
+
+    while (count-- && (ptr = list_head( &request_shm_threads )))
+    {
+        thread = LIST_ENTRY( ptr, struct thread, request_shm_entry );
+        /* move it to the tail so that every thread gets its turn */
+        list_remove( ptr );
+        list_add_tail( &request_shm_threads, ptr );
+        if (__atomic_load_n( &thread->request_shm->state, __ATOMIC_ACQUIRE ) == REQUEST_SHM_REQUEST)
+            handle_shm_request( thread );
+    }
+}
+
+static void request_doorbell_poll_event( struct fd *fd, int event )
+{
+    unsigned __int64 value;
+
+    assert( get_fd_user( fd ) == request_doorbell );
+    if (read( get_unix_fd( fd ), &value, sizeof(value) ) == -1 && errno != EAGAIN)
+        fprintf( stderr, "wineserver: error reading request doorbell: %s\n", strerror( errno ));
+    handle_shm_requests();
+}
+
+/* handle the pending shared memory requests before the main loop goes to sleep,
+ * returns 0 if it must not block because new requests have been queued meanwhile */
+int prepare_shm_requests_wait(void)
+{
+    struct thread *thread;
+
+    if (list_empty( &request_shm_threads )) return 1;
+
+    handle_shm_requests();
+
+    /* the clients check server_idle after queuing their request, so either they
+     * ring the doorbell or we see their request below */
+    __atomic_store_n( &request_shm_control->server_idle, 1, __ATOMIC_SEQ_CST );
+    LIST_FOR_EACH_ENTRY( thread, &request_shm_threads, struct thread, request_shm_entry )
+    {
+        if (__atomic_load_n( &thread->request_shm->state, __ATOMIC_SEQ_CST ) != REQUEST_SHM_REQUEST) continue;
+        __atomic_store_n( &request_shm_control->server_idle, 0, __ATOMIC_SEQ_CST );
+        return 0;
+    }
+    return 1;
+}
+
+/* the main loop woke up, the clients no longer need to ring the doorbell */
+void end_shm_requests_wait(void)
+{
+    if (request_shm_control) __atomic_store_n( &request_shm_control->server_idle, 0, __ATOMIC_SEQ_CST );
+}
+
+/* release the request buffer of a dead thread */
+void release_request_shm( struct thread *thread )
+{
+    request_shm_t *shm = thread->request_shm;
+
+    if (!shm) return;
+    list_remove( &thread->request_shm_entry );
+    thread->request_shm = NULL;
+    thread->shm_request = 0;
+    __atomic_store_n( &shm->state, REQUEST_SHM_CLOSED, __ATOMIC_SEQ_CST );
+    wake_request_shm( shm );
+    munmap( (void *)shm, REQUEST_SHM_SIZE );
+}
+
+#else  /* __linux__ */
+
+int prepare_shm_requests_wait(void)
+{
+    return 1;
+}
+
+void end_shm_requests_wait(void)
+{
+}
+
+void release_request_shm( struct thread *thread )
+{
+}
+
+#endif  /* __linux__ */
+
 /* receive a file descriptor on the process socket */
 int receive_fd( struct process *process )
 {
@@ -923,8 +1272,48 @@ void close_master_socket( timeout_t timeout )
         release_object( master_socket );
         master_socket = NULL;
     }
+#ifdef __linux__
+    release_request_shm_control();
+#endif
     if (master_timeout)  /* cancel previous timeout */
         remove_timeout_user( master_timeout );
 
     master_timeout = add_timeout_user( timeout, close_socket_timeout, NULL );
 }
+
+/* get a shared memory buffer to pass requests without going through the request pipe */
+DECL_HANDLER(get_request_shm)
+{
+#ifdef __linux__
+    request_shm_t *shm;
+    int fd;
+
+    if (current->request_shm)
+    {
+        set_error( STATUS_INVALID_PARAMETER );
+        return;
+    }
+    if (!init_request_shm_control()) return;
+    if ((fd = create_temp_file( REQUEST_SHM_SIZE )) == -1) return;
+    if ((shm = mmap( NULL, REQUEST_SHM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 )) == MAP_FAILED)
+    {
+        file_set_error();
+        close( fd );
+        return;
+    }
+
+    /* arbitrary tokens, thread ids are multiples of 4 */
+    reply->buffer   = get_thread_id( current ) | 1;
+    reply->control  = get_thread_id( current ) | 2;
+    reply->doorbell = get_thread_id( current ) | 3;
+    send_client_fd( current->process, fd, reply->buffer );
+    send_client_fd( current->process, request_shm_control_fd, reply->control );
+    send_client_fd( current->process, get_unix_fd( request_doorbell->fd ), reply->doorbell );
+    close( fd );
+
+    current->request_shm = shm;
+    list_add_tail( &request_shm_threads, &current->request_shm_entry );
+#else
+    set_error( STATUS_NOT_SUPPORTED );
+#endif
+}
@@ -54,6 +54,9 @@ extern int receive_fd( struct process *process );
 extern int send_client_fd( struct process *process, int fd, obj_handle_t handle );
 extern void read_request( struct thread *thread );
 extern void write_reply( struct thread *thread );
+extern void release_request_shm( struct thread *thread );
+extern int prepare_shm_requests_wait(void);
+extern void end_shm_requests_wait(void);
 extern timeout_t monotonic_counter(void);
 extern void open_master_socket(void);
 extern void close_master_socket( timeout_t timeout );
@@ -65,6 +68,9 @@ extern int server_dir_fd, config_dir_fd;
 
 extern void trace_request(void);
 extern void trace_reply( enum request req, const union generic_reply *reply );
+extern int profile_requests;
+extern void profile_request( enum request req, process_id_t process, timeout_t time, data_size_t reply_size );
+extern void toggle_request_profile(void);
 
 /* get current tick count to return to client */
 static inline unsigned int get_tick_count(void)
@@ -313,6 +313,7 @@ DECL_HANDLER(d3dkmt_share_objects);
 DECL_HANDLER(d3dkmt_object_open_name);
 DECL_HANDLER(d3dkmt_mutex_acquire);
 DECL_HANDLER(d3dkmt_mutex_release);
+DECL_HANDLER(get_request_shm);
 
 typedef void (*req_handler)( const void *req, void *reply );
 static const req_handler req_handlers[REQ_NB_REQUESTS] =
@@ -623,6 +624,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_d3dkmt_object_open_name,
     (req_handler)req_d3dkmt_mutex_acquire,
     (req_handler)req_d3dkmt_mutex_release,
+    (req_handler)req_get_request_shm,
 };
 
 C_ASSERT( sizeof(abstime_t) == 8 );
@@ -2369,3 +2371,8 @@ C_ASSERT( offsetof(struct d3dkmt_mutex_release_request, key_value) == 20 );
 C_ASSERT( offsetof(struct d3dkmt_mutex_release_request, fence_value) == 24 );
 C_ASSERT( offsetof(struct d3dkmt_mutex_release_request, runtime_size) == 32 );
 C_ASSERT( sizeof(struct d3dkmt_mutex_release_request) == 40 );
+C_ASSERT( sizeof(struct get_request_shm_request) == 16 );
+C_ASSERT( offsetof(struct get_request_shm_reply, buffer) == 8 );
+C_ASSERT( offsetof(struct get_request_shm_reply, control) == 12 );
+C_ASSERT( offsetof(struct get_request_shm_reply, doorbell) == 16 );
+C_ASSERT( sizeof(struct get_request_shm_reply) == 24 );
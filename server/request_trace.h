@@ -3501,6 +3501,17 @@ static void dump_d3dkmt_mutex_release_request( const struct d3dkmt_mutex_release
     dump_varargs_bytes( ", runtime=", cur_size );
 }
 
+static void dump_get_request_shm_request( const struct get_request_shm_request *req )
+{
+}
+
+static void dump_get_request_shm_reply( const struct get_request_shm_reply *req )
+{
+    fprintf( stderr, " buffer=%04x", req->buffer );
+    fprintf( stderr, ", control=%04x", req->control );
+    fprintf( stderr, ", doorbell=%04x", req->doorbell );
+}
+
 typedef void (*dump_func)( const void *req );
 
 static const dump_func req_dumpers[REQ_NB_REQUESTS] =
@@ -3811,6 +3822,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] =
     (dump_func)dump_d3dkmt_object_open_name_request,
     (dump_func)dump_d3dkmt_mutex_acquire_request,
     (dump_func)dump_d3dkmt_mutex_release_request,
+    (dump_func)dump_get_request_shm_request,
 };
 
 static const dump_func reply_dumpers[REQ_NB_REQUESTS] =
@@ -4121,6 +4133,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] =
     (dump_func)dump_d3dkmt_object_open_name_reply,
     (dump_func)dump_d3dkmt_mutex_acquire_reply,
     NULL,
+    (dump_func)dump_get_request_shm_reply,
 };
 
 static const char * const req_names[REQ_NB_REQUESTS] =
@@ -4431,6 +4444,7 @@ static const char * const req_names[REQ_NB_REQUESTS] =
     "d3dkmt_object_open_name",
     "d3dkmt_mutex_acquire",
     "d3dkmt_mutex_release",
+    "get_request_shm",
 };
 
 static const struct
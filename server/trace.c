@@ -23,6 +23,7 @@
 #include <ctype.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 
@@ -1594,3 +1595,121 @@ void trace_reply( enum request req, const union generic_reply *reply )
     else fprintf( stderr, "%04x: %d() = %s\n",
                   current->id, req, get_status_name(current->error) );
 }
+
+
+/* request profiling */
+
+#define PROFILE_BUCKETS   16   /* histogram buckets, in powers of two of microseconds */
+#define PROFILE_PROCESSES 256  /* max number of processes tracked */
+#define PROFILE_TOP_PROCESSES 20
+
+struct request_profile
+{
+    unsigned int       count;                       /* number of calls */
+    timeout_t          total_time;                  /* total time spent in the handler */
+    timeout_t          max_time;                    /* longest time spent in the handler */
+    unsigned long long reply_bytes;                 /* total size of the reply data */
+    unsigned int       histogram[PROFILE_BUCKETS];  /* distribution of the handler times */
+};
+
+struct process_profile
+{
+    process_id_t       id;                          /* process id, 0 if entry is free */
+    unsigned int       count;                       /* number of requests */
+    timeout_t          total_time;                  /* total time spent in its requests */
+};
+
+int profile_requests = 0;
+static struct request_profile request_profiles[REQ_NB_REQUESTS];
+static struct process_profile process_profiles[PROFILE_PROCESSES];
+
+/* account a handled request in the profiling data */
+void profile_request( enum request req, process_id_t process, timeout_t time, data_size_t reply_size )
+{
+    struct request_profile *profile;
+    struct process_profile *proc;
+    timeout_t usecs = time / 10;
+    unsigned int i, bucket = 0;
+
+    if (req >= REQ_NB_REQUESTS) return;
+
+    profile = &request_profiles[req];
+    profile->count++;
+    profile->total_time += time;
+    if (time > profile->max_time) profile->max_time = time;
+    profile->reply_bytes += reply_size;
+    while (usecs && bucket < PROFILE_BUCKETS - 1)
+    {
+        usecs >>= 1;
+        bucket++;
+    }
+    profile->histogram[bucket]++;
+
+    for (i = 0; i < PROFILE_PROCESSES; i++)
+    {
+        proc = &process_profiles[(process / 4 + i) % PROFILE_PROCESSES];
+        if (proc->id && proc->id != process) continue;
+        proc->id = process;
+        proc->count++;
+        proc->total_time += time;
+        break;
+    }
+}
+
+static int compare_process_profiles( const void *p1, const void *p2 )
+{
+    const struct process_profile *proc1 = p1, *proc2 = p2;
+
+    if (proc1->total_time != proc2->total_time) return proc1->total_time > proc2->total_time ? -1 : 1;
+    return proc2->count - proc1->count;
+}
+
+/* dump the profiling data in CSV format */
+static void dump_request_profile(void)
+{
+    struct process_profile procs[PROFILE_PROCESSES];
+    unsigned int i, j, count = 0;
+
+    fprintf( stderr, "request,count,total_us,avg_us,max_us,reply_bytes" );
+    for (i = 0; i < PROFILE_BUCKETS - 1; i++) fprintf( stderr, ",lt_%uus", 1u << i );
+    fprintf( stderr, ",ge_%uus", 1u << (PROFILE_BUCKETS - 2) );  /* overflow bucket */
+    fputc( '\n', stderr );
+
+    for (i = 0; i < REQ_NB_REQUESTS; i++)
+    {
+        const struct request_profile *profile = &request_profiles[i];
+
+        if (!profile->count) continue;
+        fprintf( stderr, "%s,%u,%llu,%llu,%llu,%llu", req_names[i], profile->count,
+                 (unsigned long long)profile->total_time / 10,
+                 (unsigned long long)profile->total_time / 10 / profile->count,
+                 (unsigned long long)profile->max_time / 10, profile->reply_bytes );
+        for (j = 0; j < PROFILE_BUCKETS; j++) fprintf( stderr, ",%u", profile->histogram[j] );
+        fputc( '\n', stderr );
+    }
+
+    for (i = 0; i < PROFILE_PROCESSES; i++)
+        if (process_profiles[i].id) procs[count++] = process_profiles[i];
+    qsort( procs, count, sizeof(*procs), compare_process_profiles );
+
+    fprintf( stderr, "\nprocess,count,total_us\n" );
+    for (i = 0; i < count && i < PROFILE_TOP_PROCESSES; i++)
+        fprintf( stderr, "%04x,%u,%llu\n", procs[i].id, procs[i].count,
+                 (unsigned long long)procs[i].total_time / 10 );
+}
+
+/* start request profiling, or stop it and dump the results */
+void toggle_request_profile(void)
+{
+    if (profile_requests)
+    {
+        profile_requests = 0;
+        dump_request_profile();
+        fprintf( stderr, "wineserver: request profiling stopped\n" );
+        return;
+    }
+    memset( request_profiles, 0, sizeof(request_profiles) );
+    memset( process_profiles, 0, sizeof(process_profiles) );
+    profile_requests = 1;
+    fprintf( stderr, "wineserver: request profiling started\n" );
+}